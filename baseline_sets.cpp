@@ -0,0 +1,91 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <string>
+
+#include "baseline_sets.h"
+#include "perf_counters.h"
+
+// reference engines under the cuckoo_con_v2 workload: 100 keys in a 1000-slot set, then
+// 80% lookups, 10% adds, 10% removes over keys 0..1000. single-threaded engines ignore
+// the thread count, like cuckoo_seq
+template<typename Set>
+void run(size_t num_threads) {
+    const size_t num_slots = 1000;
+    const size_t num_ops = 10000;
+
+    if (!Set::thread_safe) num_threads = 1;
+    const size_t ops_per_thread = num_ops / num_threads;
+    const int num_iter = 50;
+    double total_time = 0.0;
+
+    PerfCounters perf;
+    for (int i = 0; i < num_iter; i++) {
+        Set hashset(num_slots);
+        std::mt19937 fill(std::random_device{}());
+        std::uniform_int_distribution<> fillDist(0, 1000);
+        for (int k = 0; k < 100; k++) hashset.add(fillDist(fill));
+
+        std::vector<std::thread> threads;
+        perf.start();
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t t = 0; t < num_threads; t++) {
+            threads.emplace_back([&hashset, ops_per_thread]() {
+                std::random_device rd;
+                std::mt19937 gen(rd());
+                std::uniform_int_distribution<> opDist(1, 100);
+                std::uniform_int_distribution<> keyDist(0, 1000);
+                for (size_t i = 0; i < ops_per_thread; i++) {
+                    int op = opDist(gen);
+                    int key = keyDist(gen);
+                    if (op <= 80) {
+                        hashset.contains(key);
+                    } else if (op <= 90) {
+                        hashset.add(key);
+                    } else {
+                        hashset.remove(key);
+                    }
+                }
+            });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        perf.stop();
+        std::chrono::duration<double, std::micro> duration = end - start;
+        total_time += duration.count();
+    }
+    double avg_time = total_time / num_iter;
+    std::cout << "Average execution time (microseconds): " << avg_time << std::endl;
+    perf.report(std::cout, num_iter * ops_per_thread * num_threads);
+}
+
+int main(int argc, char* argv[]) {
+    size_t num_threads = 1;
+    if (argc >= 2) {
+        num_threads = std::stoul(argv[1]);
+    }
+    const std::string engine = argc >= 3 ? argv[2] : "std";
+
+    if (engine == "std") {
+        run<StdSet<int>>(num_threads);
+    } else if (engine == "std_locked") {
+        run<Locked<StdSet<int>>>(num_threads);
+    } else if (engine == "std_sharded") {
+        run<Sharded<StdSet<int>>>(num_threads);
+    } else if (engine == "swiss") {
+        run<SwissSet<int>>(num_threads);
+    } else if (engine == "swiss_locked") {
+        run<Locked<SwissSet<int>>>(num_threads);
+    } else if (engine == "chained") {
+        run<ChainedSet<int>>(num_threads);
+    } else {
+        std::cerr << "unknown engine " << engine
+                  << " (std, std_locked, std_sharded, swiss, swiss_locked, chained)" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,367 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "cuckoo_table.h"
+
+// reference engines for the benchmarks, with the same add/remove/contains/size interface
+// as CuckooTable so every workload runs unchanged against them. none of them is meant to
+// be used by the library itself
+
+// spreads std::hash, which is the identity for integers, over all 64 bits
+template<typename Key>
+inline uint64_t baseline_hash(const Key& key) {
+    uint64_t h = std::hash<Key>{}(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// std::unordered_set behind the common interface; single-threaded
+template<typename Key>
+class StdSet {
+public:
+    using key_type = Key;
+    static constexpr bool thread_safe = false;
+
+    explicit StdSet(size_t capacity = 64) { keys.reserve(capacity); }
+
+    bool add(const Key& key) { return keys.insert(key).second; }
+    bool remove(const Key& key) { return keys.erase(key) > 0; }
+    bool contains(const Key& key) const { return keys.count(key) > 0; }
+    size_t size() const { return keys.size(); }
+
+private:
+    std::unordered_set<Key> keys;
+};
+
+// open addressing in the style of swiss tables: one control byte per slot holding empty,
+// deleted, or 7 bits of the key's hash; a lookup matches 16 control bytes at a time (one
+// SSE2 compare where available) and compares keys only on a hit. groups are probed
+// triangularly and the table grows at 7/8 full. single-threaded
+template<typename Key>
+class SwissSet {
+public:
+    using key_type = Key;
+    static constexpr bool thread_safe = false;
+
+    explicit SwissSet(size_t capacity = 64) { resize(groups_for(capacity)); }
+
+    bool add(const Key& key) {
+        const uint64_t h = baseline_hash(key);
+        if (find(key, h) >= 0) return false;
+        if (used + 1 > (groups * GROUP) / 8 * 7) {
+            // mostly tombstones: clean up in place, otherwise double
+            resize(count * 2 < used ? groups : groups * 2);
+        }
+        const size_t s = free_slot(h);
+        used += ctrl[s] == EMPTY;
+        ctrl[s] = tag(h);
+        slots[s] = key;
+        count++;
+        return true;
+    }
+
+    bool remove(const Key& key) {
+        const long s = find(key, baseline_hash(key));
+        if (s < 0) return false;
+        // a group with an empty slot ends every probe that reaches it, so the slot can be
+        // emptied instead of left as a tombstone
+        const size_t g = static_cast<size_t>(s) / GROUP;
+        const bool empty_in_group = match(g, EMPTY) != 0;
+        ctrl[static_cast<size_t>(s)] = empty_in_group ? EMPTY : DELETED;
+        used -= empty_in_group;
+        count--;
+        return true;
+    }
+
+    bool contains(const Key& key) const { return find(key, baseline_hash(key)) >= 0; }
+    size_t size() const { return count; }
+
+private:
+    static constexpr size_t GROUP = 16;
+    static constexpr int8_t EMPTY = -128;
+    static constexpr int8_t DELETED = -2;
+
+    std::vector<int8_t> ctrl;
+    std::vector<Key> slots;
+    size_t groups = 0;
+    size_t count = 0;
+    size_t used = 0; // full slots plus tombstones
+
+    static size_t groups_for(size_t capacity) {
+        return next_pow2((capacity * 8 / 7 + GROUP - 1) / GROUP);
+    }
+
+    static int8_t tag(uint64_t h) { return static_cast<int8_t>(h & 0x7f); }
+    size_t first_group(uint64_t h) const { return (h >> 7) & (groups - 1); }
+
+    // bit i set where control byte i of group g equals c
+    uint32_t match(size_t g, int8_t c) const {
+        const int8_t* p = ctrl.data() + g * GROUP;
+#if defined(__SSE2__)
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(c))));
+#else
+        uint32_t bits = 0;
+        for (size_t i = 0; i < GROUP; i++) bits |= static_cast<uint32_t>(p[i] == c) << i;
+        return bits;
+#endif
+    }
+
+    // bit i set where slot i of group g is empty or deleted (sign bit of the control byte)
+    uint32_t match_free(size_t g) const {
+        const int8_t* p = ctrl.data() + g * GROUP;
+#if defined(__SSE2__)
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+#else
+        uint32_t bits = 0;
+        for (size_t i = 0; i < GROUP; i++) bits |= static_cast<uint32_t>(p[i] < 0) << i;
+        return bits;
+#endif
+    }
+
+    long find(const Key& key, uint64_t h) const {
+        size_t g = first_group(h);
+        for (size_t step = 1;; step++) {
+            for (uint32_t bits = match(g, tag(h)); bits; bits &= bits - 1) {
+                const size_t s = g * GROUP + static_cast<size_t>(__builtin_ctz(bits));
+                if (slots[s] == key) return static_cast<long>(s);
+            }
+            if (match(g, EMPTY) || step > groups) return -1;
+            g = (g + step) & (groups - 1);
+        }
+    }
+
+    // first empty or deleted slot on the probe sequence; the table is never full
+    size_t free_slot(uint64_t h) const {
+        size_t g = first_group(h);
+        for (size_t step = 1;; step++) {
+            const uint32_t bits = match_free(g);
+            if (bits) return g * GROUP + static_cast<size_t>(__builtin_ctz(bits));
+            g = (g + step) & (groups - 1);
+        }
+    }
+
+    void resize(size_t new_groups) {
+        std::vector<int8_t> old_ctrl = std::move(ctrl);
+        std::vector<Key> old_slots = std::move(slots);
+        groups = new_groups;
+        ctrl.assign(groups * GROUP, EMPTY);
+        slots.assign(groups * GROUP, Key());
+        used = count;
+        for (size_t s = 0; s < old_ctrl.size(); s++) {
+            if (old_ctrl[s] < 0) continue;
+            const uint64_t h = baseline_hash(old_slots[s]);
+            const size_t d = free_slot(h);
+            ctrl[d] = tag(h);
+            slots[d] = old_slots[s];
+        }
+    }
+};
+
+// concurrent separate chaining: a bucket array of singly linked lists under the repo's
+// lock policies (stripe locks by bucket, the whole table to resize at load 1), in the
+// style of segment-locked concurrent hash maps
+template<typename Key, typename LockPolicy = StripedLock<1024, std::shared_mutex>>
+class ChainedSet {
+public:
+    using key_type = Key;
+    static constexpr bool thread_safe = LockPolicy::thread_safe;
+
+    explicit ChainedSet(size_t capacity = 64) : heads(next_pow2(capacity), nullptr), buckets(heads.size()) {}
+
+    ~ChainedSet() {
+        for (Node* n : heads) {
+            while (n) delete std::exchange(n, n->next);
+        }
+    }
+
+    ChainedSet(const ChainedSet&) = delete;
+    ChainedSet& operator=(const ChainedSet&) = delete;
+
+    bool add(const Key& key) {
+        const uint64_t h = baseline_hash(key);
+        bool added = false;
+        size_t n = 0;
+        with_bucket(true, h, [&](size_t b, size_t cap) {
+            n = cap;
+            for (Node* p = heads[b]; p; p = p->next) {
+                if (p->key == key) return;
+            }
+            heads[b] = new Node{key, heads[b]};
+            count.inc();
+            added = true;
+        });
+        if (added && count.load() > n) {
+            locks.exclusive_all([&] {
+                if (buckets == n) rehash(n * 2);
+            });
+        }
+        return added;
+    }
+
+    bool remove(const Key& key) {
+        bool removed = false;
+        with_bucket(true, baseline_hash(key), [&](size_t b, size_t) {
+            for (Node** p = &heads[b]; *p; p = &(*p)->next) {
+                if ((*p)->key == key) {
+                    delete std::exchange(*p, (*p)->next);
+                    count.dec();
+                    removed = true;
+                    return;
+                }
+            }
+        });
+        return removed;
+    }
+
+    bool contains(const Key& key) const {
+        bool found = false;
+        with_bucket(false, baseline_hash(key), [&](size_t b, size_t) {
+            for (const Node* p = heads[b]; p; p = p->next) {
+                if (p->key == key) {
+                    found = true;
+                    return;
+                }
+            }
+        });
+        return found;
+    }
+
+    size_t size() const { return count.load(); }
+
+private:
+    struct Node {
+        Key key;
+        Node* next;
+    };
+
+    std::vector<Node*> heads;
+    size_t buckets;
+    typename LockPolicy::Counter count;
+    LockPolicy locks;
+
+    // runs f(bucket, bucket count) under that bucket's lock, retrying across resizes
+    template<typename F>
+    void with_bucket(bool exclusive, uint64_t h, F&& f) const {
+        while (true) {
+            const size_t n = __atomic_load_n(&buckets, __ATOMIC_RELAXED);
+            const size_t b = h & (n - 1);
+            bool stale = false;
+            auto section = [&] {
+                if (buckets != n) {
+                    stale = true;
+                    return;
+                }
+                f(b, n);
+            };
+            if (exclusive) {
+                locks.exclusive(b, b, section);
+            } else {
+                locks.shared(b, b, section);
+            }
+            if (!stale) return;
+        }
+    }
+
+    // caller holds every lock
+    void rehash(size_t n) {
+        std::vector<Node*> old(n, nullptr);
+        old.swap(heads);
+        for (Node* p : old) {
+            while (p) {
+                Node* next = p->next;
+                const size_t b = baseline_hash(p->key) & (n - 1);
+                p->next = heads[b];
+                heads[b] = p;
+                p = next;
+            }
+        }
+        __atomic_store_n(&buckets, n, __ATOMIC_RELAXED);
+    }
+};
+
+// any single-threaded set behind one global mutex
+template<typename Set>
+class Locked {
+public:
+    using key_type = typename Set::key_type;
+    static constexpr bool thread_safe = true;
+
+    explicit Locked(size_t capacity = 64) : set(capacity) {}
+
+    bool add(const key_type& key) {
+        std::lock_guard<std::mutex> guard(m);
+        return set.add(key);
+    }
+    bool remove(const key_type& key) {
+        std::lock_guard<std::mutex> guard(m);
+        return set.remove(key);
+    }
+    bool contains(const key_type& key) const {
+        std::lock_guard<std::mutex> guard(m);
+        return set.contains(key);
+    }
+    size_t size() const {
+        std::lock_guard<std::mutex> guard(m);
+        return set.size();
+    }
+
+private:
+    mutable std::mutex m;
+    Set set;
+};
+
+// any single-threaded set split into Shards independent sets, each behind its own mutex
+template<typename Set, size_t Shards = 64>
+class Sharded {
+public:
+    using key_type = typename Set::key_type;
+    static constexpr bool thread_safe = true;
+
+    explicit Sharded(size_t capacity = 64) {
+        for (auto& s : shards) s.set = Set(capacity / Shards + 1);
+    }
+
+    bool add(const key_type& key) { return with_shard(key, [&](Set& s) { return s.add(key); }); }
+    bool remove(const key_type& key) { return with_shard(key, [&](Set& s) { return s.remove(key); }); }
+    bool contains(const key_type& key) const {
+        return with_shard(key, [&](const Set& s) { return s.contains(key); });
+    }
+    size_t size() const {
+        size_t n = 0;
+        for (auto& s : shards) {
+            std::lock_guard<std::mutex> guard(s.m);
+            n += s.set.size();
+        }
+        return n;
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::mutex m;
+        Set set;
+    };
+    mutable std::array<Shard, Shards> shards;
+
+    // the top bits pick the shard, so the set inside still sees well-spread hashes
+    template<typename F>
+    auto with_shard(const key_type& key, F&& f) const {
+        Shard& s = shards[(baseline_hash(key) >> 40) % Shards];
+        std::lock_guard<std::mutex> guard(s.m);
+        return f(s.set);
+    }
+};
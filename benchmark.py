@@ -5,27 +5,61 @@ import csv
 thread_counts = [1, 2, 4, 8, 16]
 # Define the programs to test.
 programs = ["./cuckoo_seq", "./cuckoo_seq_v2", "./cuckoo_con", "./cuckoo_con_v2", "./cuckoo_trans"]
+# Reference engines on the same workload as cuckoo_con_v2 (std and swiss ignore the thread count).
+programs += ["./baseline_sets std", "./baseline_sets std_locked", "./baseline_sets std_sharded",
+             "./baseline_sets swiss", "./baseline_sets swiss_locked", "./baseline_sets chained"]
+# Read-only lookups: live engines against frozen snapshots (extra args follow the thread count).
+programs += ["./cuckoo_frozen seq", "./cuckoo_frozen con", "./cuckoo_frozen bucketed", "./cuckoo_frozen perfect"]
+# Bulk set algebra on two 1M-key sets; the thread count is the worker count.
+programs += ["./cuckoo_setops merge", "./cuckoo_setops intersect", "./cuckoo_setops subtract"]
+# Bounded CLOCK cache against the growing table under zipfian keys (skew follows the thread count).
+programs += ["./cuckoo_cache 0.8", "./cuckoo_cache 0.99", "./cuckoo_cache 1.2", "./cuckoo_cache 0.99 table"]
+# One shared-memory set: the thread count becomes the number of worker processes (or threads).
+programs += ["./cuckoo_shared", "./cuckoo_shared threads"]
+# Background delta checkpoints every 1ms at 2%, 10% and 30% writes.
+programs += ["./cuckoo_checkpoint 2", "./cuckoo_checkpoint 10", "./cuckoo_checkpoint 30"]
+# Insert-only growth from one bucket; threads that hit a resize help migrate.
+programs += ["./cuckoo_resize"]
+# Zipfian lookups on a 4M-key table after promoting sampled hot keys, and without ("off").
+programs += ["./cuckoo_hot 0.8", "./cuckoo_hot 0.99", "./cuckoo_hot 1.2", "./cuckoo_hot 0.99 off", "./cuckoo_hot 1.2 off"]
+# 8M keys grown from one bucket, then lookups: full-key table against partial-key neighbourhoods.
+programs += ["./cuckoo_partial full", "./cuckoo_partial any", "./cuckoo_partial page", "./cuckoo_partial lines"]
+# End to end over a unix socket: the thread count is the connection count; batch keys per request, requests in flight.
+programs += ["./cuckoo_client 1 8", "./cuckoo_client 16 8", "./cuckoo_client 64 16"]
+# Trace replay split by recorded thread; "synthetic" records a sliding-window zipf trace first.
+# Point it at a captured trace to evaluate on real key skew and churn.
+programs += ["./cuckoo_replay synthetic", "./cuckoo_replay synthetic paced"]
+# 4M distinct keys into a presized table: buffered writers, add() per key, and one thread on the v2 table.
+programs += ["./cuckoo_ingest buffered", "./cuckoo_ingest direct", "./cuckoo_ingest seq"]
+
+# Hardware counters printed by each binary as "<name> per op: <value>" (n/a when unavailable).
+counter_names = ["Cycles", "Instructions", "L1D misses", "LLC misses", "dTLB misses", "Branch misses"]
 
 results = []
 
 for prog in programs:
     for threads in thread_counts:
-        result = subprocess.run([prog, str(threads)], capture_output=True, text=True)
+        cmd = prog.split()
+        result = subprocess.run([cmd[0], str(threads)] + cmd[1:], capture_output=True, text=True)
         output = result.stdout.strip()
-        # Look for the line with the average execution time.
+        avg_time = None
+        counters = {name: "" for name in counter_names}
         for line in output.splitlines():
-            if "Average execution time" in line:
-                parts = line.split(":")
-                if len(parts) >= 2:
-                    avg_time = parts[1].strip()
-                    results.append((prog, threads, float(avg_time)))
-                break
+            if ":" not in line:
+                continue
+            label, value = (part.strip() for part in line.split(":", 1))
+            if label.startswith("Average execution time"):
+                avg_time = float(value)
+            elif label.endswith(" per op") and label[:-len(" per op")] in counters and value != "n/a":
+                counters[label[:-len(" per op")]] = float(value)
+        if avg_time is not None:
+            results.append((prog, threads, avg_time, [counters[name] for name in counter_names]))
 
-# Write the results to a CSV file.
+# Write the results to a CSV file; counter columns are empty when the counter was unavailable.
 with open("results.csv", "w", newline="") as csvfile:
     writer = csv.writer(csvfile)
-    writer.writerow(["Program", "Threads", "AverageExecutionTime"])
-    for prog, threads, avg_time in results:
-        writer.writerow([prog, threads, avg_time])
+    writer.writerow(["Program", "Threads", "AverageExecutionTime"] + [name + " per op" for name in counter_names])
+    for prog, threads, avg_time, counters in results:
+        writer.writerow([prog, threads, avg_time] + counters)
         
 print("Benchmark results saved to results.csv")
\ No newline at end of file
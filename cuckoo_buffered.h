@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "cuckoo_table.h"
+
+// per-thread write buffer over a CuckooTable. add() and remove() only record the write;
+// once capacity distinct keys are pending, or on flush(), they go to the table through
+// apply_updates(), which partitions them by lock stripe and applies them in locked groups.
+// writes to a key already pending replace it, so only the last one reaches the table.
+//
+// contains() answers from the pending writes first, so a thread always sees its own
+// writes; other threads see them after the flush. one writer per thread, not shared
+template<typename Table>
+class BufferedWriter {
+public:
+    using key_type = typename Table::key_type;
+    using Update = typename Table::Update;
+    using ApplyResult = typename Table::ApplyResult;
+
+    explicit BufferedWriter(Table& table, size_t capacity = 1024)
+        : table(table), limit(std::max<size_t>(1, capacity)),
+          slots(next_pow2(2 * limit), EMPTY) {
+        updates.reserve(limit);
+    }
+
+    ~BufferedWriter() { flush(); }
+
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    void add(const key_type& key) { record(key, true); }
+    void remove(const key_type& key) { record(key, false); }
+
+    bool contains(const key_type& key) const {
+        const uint32_t p = slots[probe(key)];
+        return p != EMPTY ? updates[p].add : table.contains(key);
+    }
+
+    // applies every pending write; the counts are of writes that changed the table since
+    // the last flush(), including the flushes a full buffer made on its own
+    ApplyResult flush() {
+        apply();
+        return std::exchange(applied, ApplyResult{});
+    }
+
+    size_t pending() const { return updates.size(); }
+
+private:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    Table& table;
+    const size_t limit;
+    std::vector<Update> updates;  // pending writes, one per key
+    std::vector<uint32_t> slots;  // open addressing over keys: index into updates
+    ApplyResult applied;          // since the last flush()
+
+    void apply() {
+        if (updates.empty()) return;
+        const ApplyResult result = table.apply_updates(updates.data(), updates.size());
+        applied.added += result.added;
+        applied.removed += result.removed;
+        updates.clear();
+        std::fill(slots.begin(), slots.end(), EMPTY);
+    }
+
+    // the slot holding key's write, or the empty slot where it would go
+    size_t probe(const key_type& key) const {
+        const size_t mask = slots.size() - 1;
+        for (size_t i = MixHashers<key_type>::h1(key) & mask;; i = (i + 1) & mask) {
+            if (slots[i] == EMPTY || updates[slots[i]].key == key) return i;
+        }
+    }
+
+    void record(const key_type& key, bool add) {
+        size_t i = probe(key);
+        if (slots[i] != EMPTY) {
+            updates[slots[i]].add = add;
+            return;
+        }
+        if (updates.size() == limit) {
+            apply();
+            i = probe(key);
+        }
+        slots[i] = static_cast<uint32_t>(updates.size());
+        updates.push_back(Update{key, add});
+    }
+};
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <memory>
+
+#include "cuckoo_cache.h"
+#include "perf_counters.h"
+#include "zipf.h"
+
+// read-through cache under a zipfian key stream: lookup, insert on miss
+using Cache = CuckooCache<int, 4, MixHashers<int>, StripedLock<1024, std::shared_mutex>, Pow2Storage>;
+using Unbounded = CuckooTable<int, 4, MixHashers<int>, StripedLock<1024, std::shared_mutex>, Pow2Storage>;
+
+template<typename Set>
+size_t run_stream(Set& set, const std::vector<std::vector<int>>& streams) {
+    std::atomic<size_t> hits{0};
+    std::vector<std::thread> threads;
+    for (const auto& keys : streams) {
+        threads.emplace_back([&set, &keys, &hits]() {
+            size_t local = 0;
+            for (int key : keys) {
+                if (set.contains(key)) {
+                    local++;
+                } else {
+                    set.add(key);
+                }
+            }
+            hits += local;
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    return hits.load();
+}
+
+int main(int argc, char* argv[]) {
+    const size_t num_keys = 1000000;   // key universe
+    const size_t cached_keys = 100000; // cache budget: a tenth of the universe
+    const size_t num_ops = 1000000;
+
+    size_t num_threads = 1;
+    if (argc >= 2) {
+        num_threads = std::stoul(argv[1]);
+    }
+    const double skew = argc >= 3 ? std::stod(argv[2]) : 0.99;
+    const std::string engine = argc >= 4 ? argv[3] : "cache";
+
+    // key streams are drawn up front so the timed region only touches the set
+    ZipfGenerator zipf(num_keys, skew);
+    std::vector<std::vector<int>> streams(num_threads);
+    std::mt19937 gen(std::random_device{}());
+    for (auto& keys : streams) {
+        for (size_t i = 0; i < num_ops / num_threads; i++) keys.push_back(zipf(gen));
+    }
+    const size_t total_ops = (num_ops / num_threads) * num_threads;
+
+    const int num_iter = 5;
+    double total_time = 0.0;
+    size_t total_hits = 0;
+    size_t final_size = 0, evictions = 0, bytes = 0;
+
+    PerfCounters perf;
+    auto run = [&](auto make, auto describe) {
+        for (int i = 0; i < num_iter; i++) {
+            auto set = make();
+            perf.start();
+            auto start = std::chrono::high_resolution_clock::now();
+            total_hits += run_stream(*set, streams);
+            auto end = std::chrono::high_resolution_clock::now();
+            perf.stop();
+            std::chrono::duration<double, std::micro> duration = end - start;
+            total_time += duration.count();
+            describe(*set);
+        }
+    };
+
+    if (engine == "table") {
+        // unbounded baseline: same start size, grows instead of evicting
+        run([&] { return std::make_unique<Unbounded>(cached_keys / Unbounded::slots_per_bucket / 2); },
+            [&](const Unbounded& t) {
+                final_size = t.size();
+                bytes = t.bucket_count() * 2 * (Unbounded::slots_per_bucket * sizeof(int) + 1);
+            });
+    } else {
+        run([&] { return std::make_unique<Cache>(Cache::buckets_for_bytes(cached_keys * sizeof(int) * 2)); },
+            [&](const Cache& c) {
+                final_size = c.size();
+                evictions = c.evictions();
+                bytes = c.memory_bytes();
+            });
+    }
+
+    std::cout << "Hit rate: " << static_cast<double>(total_hits) / (total_ops * num_iter) << std::endl;
+    std::cout << "Final size: " << final_size << ", evictions: " << evictions
+              << ", approx bytes: " << bytes << std::endl;
+    double avg_time = total_time / num_iter;
+    std::cout << "Average execution time (microseconds): " << avg_time << std::endl;
+    perf.report(std::cout, num_iter * total_ops);
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+#include "cuckoo_table.h"
+
+// bounded-capacity cuckoo set for hot-key caching: a CuckooTable with ClockEviction. the
+// bucket count is fixed at construction and never grows. an insert that finds both
+// candidate buckets full first looks for a cuckoo path like any other table, and only
+// when none frees a slot does it evict a victim among the 2 * SlotsPerBucket candidates
+// with CLOCK. once the cache is nearly full, inserts go straight to eviction.
+//
+// contains() sets the hit slot's reference bit with an atomic or while holding only the
+// shared side of the stripe locks, so readers never wait on each other. the bits are
+// atomics, so TransactionalLock is not supported
+template<typename Key,
+         size_t SlotsPerBucket = 4,
+         typename Hashers = MixHashers<Key>,
+         typename LockPolicy = NoLock,
+         typename Storage = Pow2Storage>
+class CuckooCache {
+    static_assert(!runs_in_transactions<LockPolicy>::value,
+                  "CuckooCache keeps atomic reference bits, which transactions cannot touch");
+
+public:
+    using key_type = Key;
+    using Table = CuckooTable<Key, SlotsPerBucket, Hashers, LockPolicy, Storage, NoDirtyTracking, NoPromotion,
+                              ClockEviction>;
+    static constexpr size_t slots_per_bucket = SlotsPerBucket;
+
+    explicit CuckooCache(size_t num_buckets) : table(num_buckets) {}
+
+    // buckets per table that keep both tables within a memory budget
+    static size_t buckets_for_bytes(size_t bytes) {
+        const size_t n = std::max<size_t>(1, bytes / (2 * Table::bucket_bytes));
+        if constexpr (std::is_same_v<Storage, Pow2Storage>) {
+            size_t p = 1;
+            while (p * 2 <= n) p *= 2; // round down, rounding up would overshoot the budget
+            return p;
+        } else {
+            return n;
+        }
+    }
+
+    CuckooCache(const CuckooCache&) = delete;
+    CuckooCache& operator=(const CuckooCache&) = delete;
+
+    // lookup that marks the key recently used
+    bool contains(const Key& key) const { return table.contains(key); }
+
+    // true if key was inserted; a full cache makes room by eviction, never by growing
+    bool add(const Key& key) { return table.add(key); }
+
+    bool remove(const Key& key) { return table.remove(key); }
+
+    size_t size() const {
+        return table.size();
+    }
+
+    // total slots, the most keys the cache will ever hold
+    size_t slot_count() const {
+        return table.slot_count();
+    }
+
+    size_t evictions() const {
+        return table.evictions();
+    }
+
+    size_t memory_bytes() const {
+        return 2 * table.bucket_count() * Table::bucket_bytes;
+    }
+
+private:
+    Table table;
+};
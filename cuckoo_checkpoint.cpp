@@ -0,0 +1,127 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <cstdio>
+
+#include <unistd.h>
+
+#include "cuckoo_checkpoint.h"
+#include "perf_counters.h"
+
+// mixed workload on a 1M-key table while a background checkpointer appends dirty groups
+using CuckooHash = CuckooTable<int, 4, MixHashers<int>, StripedLock<1024, std::shared_mutex>, Pow2Storage,
+                               DirtyGroups<16>>;
+
+// layouts whose groups are not a whole number of 8-byte words, for the round trip
+using OddGroups = CuckooTable<int, 4, MixHashers<int>, StripedLock<64, std::shared_mutex>, Pow2Storage,
+                              DirtyGroups<5>>;
+using OddCapacity = CuckooTable<int, 4, MixHashers<int>, StripedLock<64, std::shared_mutex>, DynamicStorage,
+                                DirtyGroups<64>>;
+
+// checkpoints a table through deltas and a fold, then restores the log into a fresh table
+// and checks it holds the same keys
+template<typename Table>
+bool round_trip(size_t capacity, const std::string& path) {
+    Table original(capacity);
+    original.populate(capacity * 2, 0, 1000000);
+    {
+        Checkpointer<Table> checkpointer(original, path);
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<> keyDist(0, 1000000);
+        for (int round = 0; round < 8; round++) {
+            for (int i = 0; i < 100; i++) {
+                original.add(keyDist(gen));
+                original.remove(keyDist(gen));
+            }
+            checkpointer.checkpoint();
+            if (round == 3) checkpointer.compact();
+        }
+        checkpointer.compact();
+    }
+    Table restored(1);
+    const size_t records = restore_checkpoint(restored, path);
+    std::remove(path.c_str());
+    bool same = records == 1 && restored.size() == original.size();
+    original.for_each([&](int key) { same = same && restored.contains(key); });
+    return same;
+}
+
+int main(int argc, char* argv[]) {
+    const size_t num_keys = 1000000;
+    const size_t num_ops = 1000000;
+    const int key_max = 2 * static_cast<int>(num_keys);
+
+    size_t num_threads = 1;
+    if (argc >= 2) {
+        num_threads = std::stoul(argv[1]);
+    }
+    const int write_pct = argc >= 3 ? std::stoi(argv[2]) : 10; // half adds, half removes
+    const auto interval = std::chrono::milliseconds(argc >= 4 ? std::stoi(argv[3]) : 1);
+    const size_t ops_per_thread = num_ops / num_threads;
+
+    CuckooHash hashset(num_keys / CuckooHash::slots_per_bucket);
+    hashset.populate(num_keys, 0, key_max);
+
+    const std::string path = "/tmp/cuckoo_checkpoint_" + std::to_string(getpid()) + ".log";
+    if (!round_trip<OddGroups>(1024, path) || !round_trip<OddCapacity>(1001, path)) {
+        std::cerr << "Checkpoint round trip lost keys" << std::endl;
+        return 1;
+    }
+    Checkpointer<CuckooHash> checkpointer(hashset, path);
+    const size_t full_bytes = checkpointer.checkpoint(); // the base image, outside the timing
+
+    const int num_iter = 5;
+    double total_time = 0.0;
+
+    PerfCounters perf;
+    for (int i = 0; i < num_iter; i++) {
+        checkpointer.start(interval);
+        std::vector<std::thread> threads;
+        perf.start();
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t t = 0; t < num_threads; t++) {
+            threads.emplace_back([&hashset, ops_per_thread, write_pct, key_max]() {
+                std::random_device rd;
+                std::mt19937 gen(rd());
+                std::uniform_int_distribution<> opDist(1, 100);
+                std::uniform_int_distribution<> keyDist(0, key_max);
+                for (size_t i = 0; i < ops_per_thread; i++) {
+                    int op = opDist(gen);
+                    int key = keyDist(gen);
+                    if (op > write_pct) {
+                        hashset.contains(key);
+                    } else if (op <= write_pct / 2) {
+                        hashset.add(key);
+                    } else {
+                        hashset.remove(key);
+                    }
+                }
+            });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        perf.stop();
+        checkpointer.stop();
+        std::chrono::duration<double, std::micro> duration = end - start;
+        total_time += duration.count();
+    }
+
+    const auto stats = checkpointer.stats();
+    const size_t deltas = stats.checkpoints - 1;
+    std::cout << "Full image bytes: " << full_bytes << ", checkpoints: " << deltas
+              << ", bytes per checkpoint: " << (deltas ? (stats.bytes - full_bytes) / deltas : 0)
+              << ", compactions: " << stats.compactions << std::endl;
+    std::cout << "Checkpoint pause (microseconds): average " << stats.total_pause / stats.checkpoints
+              << ", max " << stats.max_pause << std::endl;
+    double avg_time = total_time / num_iter;
+    std::cout << "Average execution time (microseconds): " << avg_time << std::endl;
+    perf.report(std::cout, num_iter * ops_per_thread * num_threads);
+
+    std::remove(path.c_str());
+    return 0;
+}
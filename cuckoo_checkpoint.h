@@ -0,0 +1,485 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cuckoo_table.h"
+
+// ---------------------------------------------------------------------------
+// delta log for tables with DirtyGroups tracking.
+//
+//   file    := FileHeader record*
+//   record  := RecordHeader payload checksum
+//   payload := Group[groups] bucket bytes of each group, back to back
+//
+// a full record holds every group and starts the table over; later records
+// overwrite the groups they carry. a torn or corrupt tail ends the log: it is
+// ignored on restore and cut off before the next append. compaction leaves a single
+// full record marked FULL_COMPACTED, which is never a torn tail, so a bad one is an error
+// ---------------------------------------------------------------------------
+
+namespace checkpoint_log {
+
+constexpr char FILE_MAGIC[8] = {'C', 'K', 'P', 'T', 'L', 'O', 'G', '1'};
+constexpr uint64_t RECORD_MAGIC = 0x6b6f6f6375636472ULL;
+constexpr size_t IO_CHUNK = size_t{1} << 20;
+constexpr uint32_t FULL_COMPACTED = 2; // RecordHeader::full of a record written by a fold
+
+struct FileHeader {
+    char magic[8];
+    uint32_t bucket_bytes;
+    uint32_t group_buckets;
+};
+
+struct RecordHeader {
+    uint64_t magic;
+    uint64_t capacity;
+    uint64_t count;
+    uint32_t groups;
+    uint32_t full;
+    uint64_t payload_bytes;
+};
+
+using Group = CheckpointDelta::Group;
+
+constexpr uint64_t CHECKSUM_SEED = 0xcbf29ce484222325ULL;
+
+// word-at-a-time FNV-style mix; catches torn writes, not tampering. a partial word is
+// carried between update() calls, so the value does not depend on how the bytes were split
+class Checksum {
+public:
+    void update(const void* data, size_t n) {
+        const auto* p = static_cast<const unsigned char*>(data);
+        if (pending) {
+            const size_t take = std::min(8 - pending, n);
+            std::memcpy(tail + pending, p, take);
+            pending += take;
+            p += take;
+            n -= take;
+            if (pending < 8) return;
+            mix(tail);
+            pending = 0;
+        }
+        for (; n >= 8; p += 8, n -= 8) mix(p);
+        std::memcpy(tail, p, n);
+        pending = n;
+    }
+
+    uint64_t value() const {
+        uint64_t v = h;
+        for (size_t i = 0; i < pending; i++) v = (v ^ tail[i]) * 0x100000001b3ULL;
+        return v;
+    }
+
+private:
+    uint64_t h = CHECKSUM_SEED;
+    unsigned char tail[8];
+    size_t pending = 0;
+
+    void mix(const unsigned char* p) {
+        uint64_t w;
+        std::memcpy(&w, p, 8);
+        h = (h ^ w) * 0x100000001b3ULL;
+    }
+};
+
+// the log cannot be read back as written, as opposed to a torn tail
+struct corrupt_log : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+[[noreturn]] inline void fail(const char* what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+inline void write_all(int fd, const void* data, size_t n) {
+    const auto* p = static_cast<const unsigned char*>(data);
+    while (n) {
+        const ssize_t w = ::write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            fail("checkpoint: write");
+        }
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+}
+
+// false on a short read, which the scanner treats as a torn tail
+inline bool read_at(int fd, void* data, size_t n, off_t offset) {
+    auto* p = static_cast<unsigned char*>(data);
+    while (n) {
+        const ssize_t r = ::pread(fd, p, n, offset);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        p += r;
+        n -= static_cast<size_t>(r);
+        offset += r;
+    }
+    return true;
+}
+
+inline off_t file_size(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) fail("checkpoint: fstat");
+    return st.st_size;
+}
+
+// calls f(header, payload_offset) for every intact record and returns where the intact
+// part of the log ends. throws if the file belongs to a different bucket layout, and
+// corrupt_log if a compacted base does not check out
+template<typename F>
+off_t scan(int fd, uint32_t bucket_bytes, uint32_t group_buckets, F&& f) {
+    const off_t end = file_size(fd);
+    FileHeader fh;
+    if (end < static_cast<off_t>(sizeof(fh)) || !read_at(fd, &fh, sizeof(fh), 0) ||
+        std::memcmp(fh.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0) {
+        throw std::runtime_error("checkpoint: not a checkpoint log");
+    }
+    if (fh.bucket_bytes != bucket_bytes || fh.group_buckets != group_buckets) {
+        throw std::runtime_error("checkpoint: log was written for a different table type");
+    }
+
+    std::vector<unsigned char> buf(IO_CHUNK);
+    off_t pos = sizeof(fh);
+    while (true) {
+        RecordHeader rh;
+        if (!read_at(fd, &rh, sizeof(rh), pos) || rh.magic != RECORD_MAGIC) return pos;
+        const off_t payload = pos + static_cast<off_t>(sizeof(rh));
+        const uint64_t table_bytes = static_cast<uint64_t>(rh.groups) * sizeof(Group);
+        if (rh.payload_bytes < table_bytes ||
+            payload + static_cast<off_t>(rh.payload_bytes + sizeof(uint64_t)) > end) {
+            return pos;
+        }
+        Checksum h;
+        for (uint64_t done = 0; done < rh.payload_bytes;) {
+            const size_t n = static_cast<size_t>(std::min<uint64_t>(IO_CHUNK, rh.payload_bytes - done));
+            if (!read_at(fd, buf.data(), n, payload + static_cast<off_t>(done))) return pos;
+            h.update(buf.data(), n);
+            done += n;
+        }
+        uint64_t stored;
+        if (!read_at(fd, &stored, sizeof(stored), payload + static_cast<off_t>(rh.payload_bytes))) return pos;
+        if (stored != h.value()) {
+            // a compacted log is renamed into place whole, so its base cannot be torn
+            if (rh.full == FULL_COMPACTED) throw corrupt_log("checkpoint: compacted base fails its checksum");
+            return pos;
+        }
+        f(rh, payload);
+        pos = payload + static_cast<off_t>(rh.payload_bytes + sizeof(uint64_t));
+    }
+}
+
+} // namespace checkpoint_log
+
+// rebuilds table from the log at path and returns how many records were applied. the
+// table must have the same key, slot and tracking configuration as the writer; it comes
+// out clean, so a Checkpointer on the same path continues with deltas
+template<typename Table>
+size_t restore_checkpoint(Table& table, const std::string& path) {
+    using namespace checkpoint_log;
+    constexpr uint32_t bucket_bytes = Table::tracking_bucket_bytes;
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) fail("checkpoint: open");
+    size_t applied = 0;
+    try {
+        scan(fd, bucket_bytes, Table::tracking_group_buckets, [&](const RecordHeader& rh, off_t payload) {
+            CheckpointDelta delta;
+            delta.capacity = rh.capacity;
+            delta.count = rh.count;
+            delta.bucket_bytes = bucket_bytes;
+            delta.full = rh.full != 0;
+            delta.groups.resize(rh.groups);
+            const size_t table_bytes = rh.groups * sizeof(Group);
+            delta.bytes.resize(rh.payload_bytes - table_bytes);
+            if (!read_at(fd, delta.groups.data(), table_bytes, payload) ||
+                !read_at(fd, delta.bytes.data(), delta.bytes.size(), payload + static_cast<off_t>(table_bytes))) {
+                throw std::runtime_error("checkpoint: log changed while restoring");
+            }
+            table.apply_delta(delta);
+            applied++;
+        });
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    return applied;
+}
+
+// appends the dirty groups of a table to a delta log, on demand or every interval from a
+// background thread. once the log outgrows compact_ratio times its last full image it is
+// folded into a single full record, keeping only the newest copy of each group; folding
+// reads the log, not the table, so it never blocks writers
+template<typename Table>
+class Checkpointer {
+public:
+    struct Stats {
+        size_t checkpoints = 0;
+        size_t groups = 0;
+        size_t bytes = 0;         // appended, compactions excluded
+        size_t compactions = 0;
+        double total_pause = 0.0; // microseconds spent holding the table's locks
+        double max_pause = 0.0;
+    };
+
+    Checkpointer(Table& t, std::string log_path, double compact_ratio = 2.0)
+        : table(t), path(std::move(log_path)), ratio(compact_ratio) {
+        open_log();
+    }
+
+    ~Checkpointer() {
+        try {
+            stop();
+        } catch (...) {
+        }
+        if (fd >= 0) ::close(fd);
+    }
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    // one round: drain the dirty groups, append and sync them, compact if due.
+    // returns the bytes appended
+    size_t checkpoint() {
+        std::lock_guard<std::mutex> guard(io);
+        auto start = std::chrono::steady_clock::now();
+        CheckpointDelta delta = table.take_delta(!has_full);
+        std::chrono::duration<double, std::micro> pause = std::chrono::steady_clock::now() - start;
+
+        const size_t written = append(delta);
+        if (delta.full) {
+            has_full = true;
+            base_bytes = written;
+        }
+        log_bytes += written;
+        counters.checkpoints++;
+        counters.groups += delta.groups.size();
+        counters.bytes += written;
+        counters.total_pause += pause.count();
+        counters.max_pause = std::max(counters.max_pause, pause.count());
+
+        if (log_bytes > ratio * base_bytes + sizeof(checkpoint_log::FileHeader)) fold();
+        return written;
+    }
+
+    void start(std::chrono::milliseconds interval) {
+        stop();
+        running = true;
+        worker = std::thread([this, interval] {
+            std::unique_lock<std::mutex> lock(wake);
+            while (running) {
+                if (stop_signal.wait_for(lock, interval, [this] { return !running; })) break;
+                lock.unlock();
+                try {
+                    checkpoint();
+                } catch (...) {
+                    error = std::current_exception();
+                    lock.lock();
+                    break;
+                }
+                lock.lock();
+            }
+        });
+    }
+
+    // joins the background thread, takes a last checkpoint if it was running, and
+    // rethrows anything it failed with
+    void stop() {
+        if (!worker.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(wake);
+            running = false;
+        }
+        stop_signal.notify_all();
+        worker.join();
+        if (error) std::rethrow_exception(std::exchange(error, nullptr));
+        checkpoint();
+    }
+
+    void compact() {
+        std::lock_guard<std::mutex> guard(io);
+        fold();
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> guard(io);
+        return counters;
+    }
+
+    size_t log_size() const {
+        std::lock_guard<std::mutex> guard(io);
+        return log_bytes;
+    }
+
+private:
+    using FileHeader = checkpoint_log::FileHeader;
+    using RecordHeader = checkpoint_log::RecordHeader;
+    using Group = checkpoint_log::Group;
+
+    Table& table;
+    std::string path;
+    double ratio;
+    int fd = -1;
+    bool has_full = false;  // the log already holds a full image to apply deltas to
+    size_t base_bytes = 0;  // size of the last full record
+    size_t log_bytes = 0;
+    Stats counters;
+
+    mutable std::mutex io; // one checkpoint or compaction at a time
+    std::thread worker;
+    std::mutex wake;
+    std::condition_variable stop_signal;
+    bool running = false;
+    std::exception_ptr error;
+
+    static FileHeader file_header() {
+        FileHeader fh{};
+        std::memcpy(fh.magic, checkpoint_log::FILE_MAGIC, sizeof(fh.magic));
+        fh.bucket_bytes = Table::tracking_bucket_bytes;
+        fh.group_buckets = Table::tracking_group_buckets;
+        return fh;
+    }
+
+    // an existing log is cut back to its last intact record; anything else starts over
+    void open_log() {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) checkpoint_log::fail("checkpoint: open");
+        off_t end = 0;
+        if (checkpoint_log::file_size(fd) > 0) {
+            try {
+                end = checkpoint_log::scan(fd, Table::tracking_bucket_bytes, Table::tracking_group_buckets,
+                                           [&](const RecordHeader& rh, off_t) {
+                                               const size_t bytes = sizeof(RecordHeader) + rh.payload_bytes + sizeof(uint64_t);
+                                               if (rh.full) base_bytes = bytes;
+                                               has_full = has_full || rh.full;
+                                           });
+            } catch (const checkpoint_log::corrupt_log&) {
+                throw; // starting over would throw the base away
+            } catch (const std::runtime_error&) {
+                end = 0; // not ours to append to
+                has_full = false;
+            }
+        }
+        if (end == 0) {
+            if (ftruncate(fd, 0) != 0) checkpoint_log::fail("checkpoint: ftruncate");
+            const FileHeader fh = file_header();
+            checkpoint_log::write_all(fd, &fh, sizeof(fh));
+            end = sizeof(fh);
+        } else if (ftruncate(fd, end) != 0) {
+            checkpoint_log::fail("checkpoint: ftruncate");
+        }
+        if (lseek(fd, end, SEEK_SET) < 0) checkpoint_log::fail("checkpoint: lseek");
+        log_bytes = static_cast<size_t>(end);
+    }
+
+    size_t append(const CheckpointDelta& delta) {
+        const size_t table_bytes = delta.groups.size() * sizeof(Group);
+        RecordHeader rh{checkpoint_log::RECORD_MAGIC, delta.capacity, delta.count,
+                        static_cast<uint32_t>(delta.groups.size()), delta.full ? 1u : 0u,
+                        table_bytes + delta.bytes.size()};
+        checkpoint_log::Checksum sum;
+        sum.update(delta.groups.data(), table_bytes);
+        sum.update(delta.bytes.data(), delta.bytes.size());
+        const uint64_t h = sum.value();
+
+        checkpoint_log::write_all(fd, &rh, sizeof(rh));
+        checkpoint_log::write_all(fd, delta.groups.data(), table_bytes);
+        checkpoint_log::write_all(fd, delta.bytes.data(), delta.bytes.size());
+        checkpoint_log::write_all(fd, &h, sizeof(h));
+        if (fdatasync(fd) != 0) checkpoint_log::fail("checkpoint: fdatasync");
+        return sizeof(rh) + rh.payload_bytes + sizeof(h);
+    }
+
+    // rewrites the log as one full record holding the newest copy of every group since
+    // the last full record, then renames it over the old log
+    void fold() {
+        struct Latest {
+            uint32_t buckets;
+            off_t offset; // of the group's bucket bytes in the old log
+        };
+        std::map<std::pair<uint32_t, uint64_t>, Latest> latest;
+        RecordHeader last{};
+        checkpoint_log::scan(fd, Table::tracking_bucket_bytes, Table::tracking_group_buckets,
+                             [&](const RecordHeader& rh, off_t payload) {
+            if (rh.full) latest.clear();
+            std::vector<Group> groups(rh.groups);
+            if (!checkpoint_log::read_at(fd, groups.data(), groups.size() * sizeof(Group), payload)) {
+                throw std::runtime_error("checkpoint: log shrank while compacting");
+            }
+            off_t offset = payload + static_cast<off_t>(groups.size() * sizeof(Group));
+            for (const Group& g : groups) {
+                latest[{g.table, g.first}] = Latest{g.buckets, offset};
+                offset += static_cast<off_t>(g.buckets) * Table::tracking_bucket_bytes;
+            }
+            last = rh;
+        });
+        if (latest.empty()) return;
+
+        const std::string tmp_path = path + ".compact";
+        const int out = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out < 0) checkpoint_log::fail("checkpoint: open");
+        try {
+            std::vector<Group> groups;
+            uint64_t bucket_bytes = 0;
+            for (const auto& [key, at] : latest) {
+                groups.push_back(Group{key.first, at.buckets, key.second});
+                bucket_bytes += static_cast<uint64_t>(at.buckets) * Table::tracking_bucket_bytes;
+            }
+            const FileHeader fh = file_header();
+            const uint64_t table_bytes = groups.size() * sizeof(Group);
+            RecordHeader rh{checkpoint_log::RECORD_MAGIC, last.capacity, last.count,
+                            static_cast<uint32_t>(groups.size()), checkpoint_log::FULL_COMPACTED,
+                            table_bytes + bucket_bytes};
+            checkpoint_log::write_all(out, &fh, sizeof(fh));
+            checkpoint_log::write_all(out, &rh, sizeof(rh));
+            checkpoint_log::write_all(out, groups.data(), table_bytes);
+            checkpoint_log::Checksum sum;
+            sum.update(groups.data(), table_bytes);
+            std::vector<unsigned char> buf;
+            for (const auto& [key, at] : latest) {
+                buf.resize(static_cast<size_t>(at.buckets) * Table::tracking_bucket_bytes);
+                if (!checkpoint_log::read_at(fd, buf.data(), buf.size(), at.offset)) {
+                    throw std::runtime_error("checkpoint: log shrank while compacting");
+                }
+                sum.update(buf.data(), buf.size());
+                checkpoint_log::write_all(out, buf.data(), buf.size());
+            }
+            const uint64_t h = sum.value();
+            checkpoint_log::write_all(out, &h, sizeof(h));
+            if (fsync(out) != 0) checkpoint_log::fail("checkpoint: fsync");
+            if (std::rename(tmp_path.c_str(), path.c_str()) != 0) checkpoint_log::fail("checkpoint: rename");
+        } catch (...) {
+            ::close(out);
+            ::unlink(tmp_path.c_str());
+            throw;
+        }
+        ::close(out);
+        ::close(fd);
+        fd = ::open(path.c_str(), O_RDWR);
+        if (fd < 0) checkpoint_log::fail("checkpoint: open");
+        log_bytes = static_cast<size_t>(checkpoint_log::file_size(fd));
+        if (lseek(fd, 0, SEEK_END) < 0) checkpoint_log::fail("checkpoint: lseek");
+        base_bytes = log_bytes - sizeof(FileHeader);
+        has_full = true;
+        counters.compactions++;
+    }
+};
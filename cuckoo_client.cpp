@@ -0,0 +1,116 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <memory>
+#include <algorithm>
+
+#include <unistd.h>
+
+#include "cuckoo_server.h"
+#include "perf_counters.h"
+
+// load generator: one thread per connection keeps depth requests of batch keys in flight
+// (10% writes) and records each request's round trip. without an address it serves
+// itself, from an in-process server on a temporary unix socket
+using CuckooHash = CuckooTable<int, 4, MixHashers<int>, StripedLock<1024, std::shared_mutex>, Pow2Storage>;
+
+struct Workload {
+    std::vector<wire::Op> ops;    // one per request
+    std::vector<int64_t> keys;    // batch per request
+};
+
+// sends every request of w, at most depth ahead of the responses; round trips go to latencies
+void drive(const std::string& address, const Workload& w, uint32_t batch, uint32_t depth,
+           std::vector<double>& latencies) {
+    using Clock = std::chrono::steady_clock;
+    CuckooClient client(address);
+    std::vector<Clock::time_point> sent_at(depth);
+    std::unique_ptr<bool[]> results = std::make_unique<bool[]>(batch);
+    const size_t requests = w.ops.size();
+    size_t sent = 0;
+    for (size_t received = 0; received < requests; received++) {
+        for (; sent < requests && sent - received < depth; sent++) {
+            sent_at[sent % depth] = Clock::now();
+            client.send(w.ops[sent], w.keys.data() + sent * batch, batch, static_cast<uint32_t>(sent));
+        }
+        const uint32_t tag = client.receive(results.get());
+        std::chrono::duration<double, std::micro> rtt = Clock::now() - sent_at[tag % depth];
+        latencies.push_back(rtt.count());
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const size_t num_keys = 1000000;
+    const size_t num_ops = 1000000;
+    const int write_pct = 10; // half adds, half removes
+
+    size_t num_connections = 1;
+    if (argc >= 2) {
+        num_connections = std::stoul(argv[1]);
+    }
+    const uint32_t batch = argc >= 3 ? static_cast<uint32_t>(std::stoul(argv[2])) : 16;
+    const uint32_t depth = argc >= 4 ? static_cast<uint32_t>(std::stoul(argv[3])) : 8;
+    std::string address = argc >= 5 ? argv[4] : "";
+
+    std::unique_ptr<CuckooHash> hashset;
+    std::unique_ptr<CuckooServer<CuckooHash>> server;
+    if (address.empty()) {
+        address = "unix:/tmp/cuckoo_client_" + std::to_string(getpid()) + ".sock";
+        hashset = std::make_unique<CuckooHash>(num_keys / CuckooHash::slots_per_bucket);
+        hashset->populate(num_keys, 0, 2 * static_cast<int>(num_keys));
+        const size_t loops = std::min<size_t>(num_connections, std::max(1u, std::thread::hardware_concurrency() / 2));
+        server = std::make_unique<CuckooServer<CuckooHash>>(*hashset, address, loops);
+        server->start();
+    }
+
+    // requests are drawn up front so the timed region only talks to the server
+    const size_t requests = std::max<size_t>(1, num_ops / num_connections / batch);
+    std::vector<Workload> workloads(num_connections);
+    std::mt19937 gen(std::random_device{}());
+    std::uniform_int_distribution<> opDist(1, 100);
+    std::uniform_int_distribution<int64_t> keyDist(0, 2 * static_cast<int64_t>(num_keys));
+    for (auto& w : workloads) {
+        for (size_t r = 0; r < requests; r++) {
+            const int op = opDist(gen);
+            w.ops.push_back(op > write_pct ? wire::CONTAINS : op <= write_pct / 2 ? wire::ADD : wire::REMOVE);
+            for (uint32_t k = 0; k < batch; k++) w.keys.push_back(keyDist(gen));
+        }
+    }
+    const size_t total_ops = requests * batch * num_connections;
+
+    const int num_iter = 5;
+    double total_time = 0.0;
+    std::vector<std::vector<double>> latencies(num_connections);
+
+    PerfCounters perf;
+    for (int i = 0; i < num_iter; i++) {
+        std::vector<std::thread> threads;
+        perf.start();
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t c = 0; c < num_connections; c++) {
+            threads.emplace_back([&, c]() { drive(address, workloads[c], batch, depth, latencies[c]); });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        perf.stop();
+        std::chrono::duration<double, std::micro> duration = end - start;
+        total_time += duration.count();
+    }
+
+    std::vector<double> all;
+    for (const auto& l : latencies) all.insert(all.end(), l.begin(), l.end());
+    std::sort(all.begin(), all.end());
+    double avg_time = total_time / num_iter;
+    std::cout << "Throughput (ops/s): " << total_ops / (avg_time / 1e6)
+              << ", request latency (microseconds): p50 " << all[all.size() / 2]
+              << ", p99 " << all[all.size() * 99 / 100] << std::endl;
+    std::cout << "Average execution time (microseconds): " << avg_time << std::endl;
+    perf.report(std::cout, num_iter * total_ops);
+
+    return 0;
+}
@@ -1,219 +1,15 @@
 #include <iostream>
 #include <vector>
-#include <optional>
-#include <functional>
 #include <random>
-#include <cassert>
 #include <chrono>
-#include <cstdlib>
-#include <mutex>
 #include <thread>
 
-template<typename T>
-struct Bucket { // states: 0 = empty, 1 = occupied, -1 = deleted
-    std::optional<T> value;
-    int state;
-    Bucket() : value(std::nullopt), state(0) {}
-};
+#include "cuckoo_table.h"
+#include "perf_counters.h"
 
+// v1: one slot per bucket, std::hash pair, modulo reduction, 8 striped mutexes
 template<typename T>
-class CuckooHash {
-private:
-    std::vector<Bucket<T>> buckets;
-    size_t count;
-    size_t capacity;
-    double threshold;
-    
-    size_t num_stripes;
-    size_t stripe_size;
-    mutable std::vector<std::mutex> locks; // mutable allows const methods to lock
-    
-    // doubles capacity and reinserts all elements
-    void rehash() {
-        // acquire all stripe locks
-        lockAllStripes();
-        capacity *= 2;
-        stripe_size = (capacity + num_stripes - 1) / num_stripes;
-        std::vector<Bucket<T>> oldBuckets = buckets;
-        buckets.clear();
-        buckets.resize(capacity);
-        count = 0;
-
-        for (auto& bucket : oldBuckets) {
-            if (bucket.state == 1) {
-                rehashAdd(*(bucket.value));
-            }
-        }
-        unlockAllStripes();
-    }
-    
-    // helper to acquire all stripe locks
-    void lockAllStripes() const { 
-        for (size_t i = 0; i < num_stripes; i++) {
-            locks[i].lock();
-        }
-    }
-    
-    // helper to release all stripe locks
-    void unlockAllStripes() const { 
-        for (size_t i = 0; i < num_stripes; i++) {
-            locks[i].unlock();
-        }
-    }
-
-    void rehashAdd(const T& key) {
-        size_t index = std::hash<T>{}(key) % capacity;
-        size_t start = index;
-        while (buckets[index].state != 0) {
-            index = (index + 1) % capacity;
-            if (index == start) break;
-        }
-        buckets[index].value = key;
-        buckets[index].state = 1;
-        count++;
-    }
-    
-public:
-    CuckooHash(size_t num_buckets = 101, double lf = 0.5, size_t stripes = 8)
-        : count(0), capacity(num_buckets), threshold(lf), num_stripes(stripes) {
-        buckets.resize(capacity);
-        locks = std::vector<std::mutex>(num_stripes);
-        stripe_size = (capacity + num_stripes - 1) / num_stripes;
-    }
-    
-    bool add(const T& key) {
-        size_t index = std::hash<T>{}(key) % capacity;
-        size_t stripe = index / stripe_size;
-        bool result = false;
-        {
-            std::unique_lock<std::mutex> lock(locks[stripe]);
-            size_t start = index;
-            while (buckets[index].state != 0) {
-                if (buckets[index].state == 1 && *(buckets[index].value) == key) {
-                    return false; 
-                }
-                index = (index + 1) % capacity;
-                if (index / stripe_size != stripe) { // moved into new stripe, fallback
-                    lock.unlock();
-                    lockAllStripes();
-                    index = std::hash<T>{}(key) % capacity;
-                    size_t start_all = index;
-                    while (buckets[index].state != 0) {
-                        if (buckets[index].state == 1 && *(buckets[index].value) == key) {
-                            unlockAllStripes();
-                            return false;
-                        }
-                        index = (index + 1) % capacity;
-                        if (index == start_all) break;
-                    }
-                    buckets[index].value = key;
-                    buckets[index].state = 1;
-                    count++;
-                    unlockAllStripes();
-                    if (static_cast<double>(count) / capacity > threshold) {
-                        rehash();
-                    }
-                    return true;
-                }
-                if (index == start) break;
-            }
-
-            buckets[index].value = key;
-            buckets[index].state = 1;
-            count++;
-            result = true;
-        } 
-        if (static_cast<double>(count) / capacity > threshold) {
-            rehash();
-        }
-        return result; 
-    }
-    
-    bool remove(const T& key) {
-        size_t index = std::hash<T>{}(key) % capacity;
-        size_t stripe = index / stripe_size;
-        {
-            std::unique_lock<std::mutex> lock(locks[stripe]);
-            size_t start = index;
-            while (buckets[index].state != 0) {
-                if (buckets[index].state == 1 && *(buckets[index].value) == key) {
-                    buckets[index].state = -1; // mark as deleted.
-                    count--;
-                    return true;
-                }
-                index = (index + 1) % capacity;
-                if (index / stripe_size != stripe) { // moved into new stripe, fallback
-                    lock.unlock();
-                    lockAllStripes();
-                    index = std::hash<T>{}(key) % capacity;
-                    size_t start_all = index;
-                    bool found = false;
-                    while (buckets[index].state != 0) {
-                        if (buckets[index].state == 1 && *(buckets[index].value) == key) {
-                            buckets[index].state = -1;
-                            count--;
-                            found = true;
-                            break;
-                        }
-                        index = (index + 1) % capacity;
-                        if (index == start_all) break;
-                    }
-                    unlockAllStripes();
-                    return found;
-                }
-                if (index == start) break;
-            }
-            return false;
-        }
-    }
-    
-    bool contains(const T& key) const {
-        size_t index = std::hash<T>{}(key) % capacity;
-        size_t stripe = index / stripe_size;
-        {
-            std::unique_lock<std::mutex> lock(const_cast<std::mutex&>(locks[stripe]));
-            size_t start = index;
-            while (buckets[index].state != 0) {
-                if (buckets[index].state == 1 && *(buckets[index].value) == key) {
-                    return true;
-                }
-                index = (index + 1) % capacity;
-                if (index / stripe_size != stripe) { // moved into new stripe, fallback
-                    lock.unlock();
-                    lockAllStripes();
-                    index = std::hash<T>{}(key) % capacity;
-                    size_t start_all = index;
-                    bool found = false;
-                    while (buckets[index].state != 0) {
-                        if (buckets[index].state == 1 && *(buckets[index].value) == key) {
-                            found = true;
-                            break;
-                        }
-                        index = (index + 1) % capacity;
-                        if (index == start_all) break;
-                    }
-                    unlockAllStripes();
-                    return found;
-                }
-                if (index == start) break;
-            }
-            return false;
-        }
-    }
-    
-    size_t size() const {
-        return count;
-    }
-    
-    void populate(size_t n, int min = 0, int max = 1000) {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<> dist(min, max);
-        for (size_t i = 0; i < n; i++) {
-            add(static_cast<T>(dist(gen)));
-        }
-    }
-};
+using CuckooHash = CuckooTable<T, 1, StdHashers<T>, StripedLock<8, std::mutex>, DynamicStorage>;
 
 int main(int argc, char* argv[]) {
     const size_t num_buckets = 1000;
@@ -229,11 +25,13 @@ int main(int argc, char* argv[]) {
     const int num_iter = 10;
     double total_time = 0.0;
     
+    PerfCounters perf;
     for (int i = 0; i < num_iter; i++) {  
-        CuckooHash<int> hashset(num_buckets, 0.5, 8);
+        CuckooHash<int> hashset(num_buckets);
         hashset.populate(100);
         
         std::vector<std::thread> threads;
+        perf.start();
         auto start = std::chrono::high_resolution_clock::now();
         for (size_t t = 0; t < num_threads; t++) {
             threads.emplace_back([&hashset, ops_per_thread]() {
@@ -258,11 +56,13 @@ int main(int argc, char* argv[]) {
             th.join();
         }
         auto end = std::chrono::high_resolution_clock::now();
+        perf.stop();
         std::chrono::duration<double, std::micro> duration = end - start;
         total_time += duration.count();
     }
     double avg_time = total_time / num_iter;
     std::cout << "Average execution time (microseconds): " << avg_time << std::endl;
+    perf.report(std::cout, num_iter * ops_per_thread * num_threads);
     
     return 0;
 }
\ No newline at end of file
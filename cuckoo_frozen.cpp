@@ -0,0 +1,90 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <string>
+
+#include "cuckoo_frozen.h"
+#include "perf_counters.h"
+
+// read-only lookup benchmark: live engines against their frozen snapshots
+using LiveSeq = CuckooTable<int, 4, MixHashers<int>, NoLock, Pow2Storage>;
+using LiveCon = CuckooTable<int, 4, MixHashers<int>, StripedLock<1024, std::shared_mutex>, Pow2Storage>;
+using Frozen = FrozenCuckooSet<int, MixHashers<int>>;
+
+template<typename Set>
+double time_lookups(const Set& set, const std::vector<std::vector<int>>& queries) {
+    std::vector<std::thread> threads;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto& keys : queries) {
+        threads.emplace_back([&set, &keys]() {
+            size_t hits = 0;
+            for (int key : keys) {
+                hits += set.contains(key);
+            }
+            volatile size_t sink = hits;
+            (void)sink;
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::micro> duration = end - start;
+    return duration.count();
+}
+
+int main(int argc, char* argv[]) {
+    const size_t num_keys = 1000000;
+    const size_t num_ops = 1000000;
+    const int key_max = 2 * static_cast<int>(num_keys); // about half the lookups hit
+
+    size_t num_threads = 1;
+    if (argc >= 2) {
+        num_threads = std::stoul(argv[1]);
+    }
+    std::string engine = argc >= 3 ? argv[2] : "bucketed";
+
+    LiveSeq seq(num_keys / LiveSeq::slots_per_bucket);
+    seq.populate(num_keys, 0, key_max);
+    LiveCon con(num_keys / LiveCon::slots_per_bucket);
+    seq.for_each([&con](int key) { con.add(key); });
+
+    // query keys are drawn up front so the timed region only does lookups
+    std::vector<std::vector<int>> queries(num_threads);
+    std::mt19937 gen(std::random_device{}());
+    std::uniform_int_distribution<> keyDist(0, key_max);
+    for (auto& keys : queries) {
+        for (size_t i = 0; i < num_ops / num_threads; i++) keys.push_back(keyDist(gen));
+    }
+
+    const int num_iter = 10;
+    double total_time = 0.0;
+
+    PerfCounters perf;
+    auto run = [&](const auto& set) {
+        for (int i = 0; i < num_iter; i++) {
+            perf.start();
+            total_time += time_lookups(set, queries);
+            perf.stop();
+        }
+    };
+
+    if (engine == "seq") {
+        run(seq);
+    } else if (engine == "con") {
+        run(con);
+    } else {
+        Frozen frozen = seq.freeze(engine == "perfect" ? FrozenIndex::perfect : FrozenIndex::bucketed);
+        std::cout << "Frozen keys: " << frozen.size() << ", load factor: " << frozen.load_factor()
+                  << ", bytes: " << frozen.memory_bytes() << std::endl;
+        run(frozen);
+    }
+
+    double avg_time = total_time / num_iter;
+    std::cout << "Average execution time (microseconds): " << avg_time << std::endl;
+    perf.report(std::cout, num_iter * (num_ops / num_threads) * num_threads);
+
+    return 0;
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "cuckoo_table.h"
+
+// multiply-shift reduction of a 64-bit hash onto [0, n), no division
+inline size_t fast_range(uint64_t h, size_t n) {
+    return static_cast<size_t>((static_cast<unsigned __int128>(h) * n) >> 64);
+}
+
+// immutable set built once from a key list. no locks, no valid flags: lookups only
+// read memory, so any number of threads may call contains() concurrently.
+//
+// FrozenIndex::bucketed packs keys into 64-byte buckets (one cache line each) at
+// ~95% load; a lookup scans at most two lines. empty slots hold a sentinel that is
+// not in the set.
+//
+// FrozenIndex::perfect stores exactly size() keys addressed by a PTHash-style
+// minimal perfect hash: a pilot per small key group picks each key's position, so
+// a lookup reads one pilot and compares one key.
+template<typename Key, typename Hashers>
+class FrozenCuckooSet {
+    static_assert(std::is_integral_v<Key>, "frozen layout packs scalar keys");
+    static_assert(64 % sizeof(Key) == 0, "keys must tile a cache line");
+
+public:
+    static constexpr size_t slots_per_line = 64 / sizeof(Key);
+
+    FrozenCuckooSet(std::vector<Key> keys, FrozenIndex index = FrozenIndex::bucketed)
+        : mode(index), count(0), empty(0), num_lines(0), num_positions(0) {
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        count = keys.size();
+        if (count == 0) return;
+        if (mode == FrozenIndex::bucketed) {
+            empty = missing_key(keys);
+            build_bucketed(keys);
+        } else {
+            build_perfect(keys);
+        }
+    }
+
+    bool contains(const Key& key) const {
+        if (count == 0) return false;
+        if (mode == FrozenIndex::perfect) {
+            const size_t g = fast_range(Hashers::h1(key), pilots.size());
+            size_t pos = position(Hashers::h2(key), pilots[g]);
+            if (pos >= count) pos = remap[pos - count];
+            return packed[pos] == key;
+        }
+        if (key == empty) return false;
+        if (scan(lines[line_of(Hashers::h1(key))], key)) return true;
+        return scan(lines[line_of(Hashers::h2(key))], key);
+    }
+
+    size_t size() const { return count; }
+
+    double load_factor() const {
+        if (mode == FrozenIndex::perfect) return count ? 1.0 : 0.0;
+        return num_lines ? static_cast<double>(count) / (num_lines * slots_per_line) : 0.0;
+    }
+
+    size_t memory_bytes() const {
+        return lines.size() * sizeof(Line) + packed.size() * sizeof(Key) +
+               pilots.size() * sizeof(uint32_t) + remap.size() * sizeof(uint32_t);
+    }
+
+private:
+    struct alignas(64) Line {
+        Key keys[slots_per_line];
+    };
+
+    static constexpr double TARGET_LOAD = 0.95;
+    static constexpr size_t MAX_KICKS = 512;
+    static constexpr size_t KEYS_PER_GROUP = 4;
+    static constexpr double PERFECT_LOAD = 0.99; // positions beyond count are remapped
+
+    FrozenIndex mode;
+    size_t count;
+    Key empty;
+    size_t num_lines;
+    size_t num_positions;
+    std::vector<Line> lines;
+    std::vector<Key> packed;
+    std::vector<uint32_t> pilots;
+    std::vector<uint32_t> remap;
+
+    // no early exit: the compare over a whole line vectorizes
+    static bool scan(const Line& line, const Key& key) {
+        unsigned hit = 0;
+        for (size_t s = 0; s < slots_per_line; s++) hit |= static_cast<unsigned>(line.keys[s] == key);
+        return hit != 0;
+    }
+
+    // largest value absent from the sorted, deduplicated keys
+    static Key missing_key(const std::vector<Key>& sorted) {
+        Key candidate = std::numeric_limits<Key>::max();
+        for (auto it = sorted.rbegin(); it != sorted.rend() && *it == candidate; ++it) candidate--;
+        return candidate;
+    }
+
+    size_t position(uint64_t h, uint32_t pilot) const {
+        return fast_range(fmix64(h ^ fmix64(pilot + 1)), num_positions);
+    }
+
+    void build_bucketed(const std::vector<Key>& keys) {
+        num_lines = static_cast<size_t>(count / (TARGET_LOAD * slots_per_line)) + 1;
+        std::mt19937_64 gen(count);
+        while (!place_all(keys, gen)) {
+            num_lines += num_lines / 64 + 1;
+        }
+    }
+
+    size_t line_of(uint64_t h) const { return fast_range(h, num_lines); }
+
+    // the candidate line of key that is not b
+    size_t other(const Key& key, size_t b) const {
+        const size_t b1 = line_of(Hashers::h1(key));
+        return b1 == b ? line_of(Hashers::h2(key)) : b1;
+    }
+
+    // bucketized cuckoo insertion with random-walk eviction
+    bool place_all(const std::vector<Key>& keys, std::mt19937_64& gen) {
+        Line blank;
+        std::fill(std::begin(blank.keys), std::end(blank.keys), empty);
+        lines.assign(num_lines, blank);
+        std::vector<uint8_t> fill(num_lines, 0);
+
+        for (Key key : keys) {
+            size_t b = line_of(Hashers::h1(key));
+            for (size_t kick = 0;; kick++) {
+                const size_t alt = other(key, b);
+                if (fill[b] < slots_per_line) {
+                    lines[b].keys[fill[b]++] = key;
+                    break;
+                }
+                if (fill[alt] < slots_per_line) {
+                    lines[alt].keys[fill[alt]++] = key;
+                    break;
+                }
+                if (kick == MAX_KICKS) return false;
+                std::swap(key, lines[b].keys[gen() % slots_per_line]);
+                b = other(key, b); // the displaced key continues from its other line
+            }
+        }
+        return true;
+    }
+
+    void build_perfect(const std::vector<Key>& keys) {
+        num_positions = static_cast<size_t>(count / PERFECT_LOAD) + 1;
+        const size_t num_groups = (count + KEYS_PER_GROUP - 1) / KEYS_PER_GROUP;
+        pilots.assign(num_groups, 0);
+
+        std::vector<std::vector<Key>> groups(num_groups);
+        for (Key key : keys) groups[fast_range(Hashers::h1(key), num_groups)].push_back(key);
+
+        // largest groups first while the position space is still empty
+        std::vector<size_t> order(num_groups);
+        for (size_t g = 0; g < num_groups; g++) order[g] = g;
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return groups[a].size() > groups[b].size();
+        });
+
+        std::vector<Key> slots(num_positions);
+        std::vector<bool> taken(num_positions, false);
+        std::vector<size_t> pos;
+        for (size_t g : order) {
+            if (groups[g].empty()) break;
+            for (uint32_t pilot = 0;; pilot++) {
+                pos.clear();
+                bool ok = true;
+                for (Key key : groups[g]) {
+                    const size_t p = position(Hashers::h2(key), pilot);
+                    if (taken[p] || std::find(pos.begin(), pos.end(), p) != pos.end()) {
+                        ok = false;
+                        break;
+                    }
+                    pos.push_back(p);
+                }
+                if (!ok) continue;
+                for (size_t i = 0; i < pos.size(); i++) {
+                    taken[pos[i]] = true;
+                    slots[pos[i]] = groups[g][i];
+                }
+                pilots[g] = pilot;
+                break;
+            }
+        }
+
+        // fold positions past count into the holes below it
+        packed.assign(slots.begin(), slots.begin() + count);
+        remap.assign(num_positions - count, 0);
+        size_t hole = 0;
+        for (size_t p = count; p < num_positions; p++) {
+            if (!taken[p]) continue;
+            while (taken[hole]) hole++;
+            packed[hole] = slots[p];
+            remap[p - count] = static_cast<uint32_t>(hole);
+            hole++;
+        }
+    }
+};
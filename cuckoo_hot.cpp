@@ -0,0 +1,82 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <string>
+
+#include "cuckoo_table.h"
+#include "perf_counters.h"
+#include "zipf.h"
+
+// zipfian lookups on a large table, with and without promoting the hot keys first
+using CuckooHash = CuckooTable<int, 4, MixHashers<int>, StripedLock<1024, std::shared_mutex>, Pow2Storage,
+                               NoDirtyTracking, HotKeyPromotion<>>;
+
+template<typename Set>
+double time_lookups(const Set& set, const std::vector<std::vector<int>>& queries) {
+    std::vector<std::thread> threads;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto& keys : queries) {
+        threads.emplace_back([&set, &keys]() {
+            size_t hits = 0;
+            for (int key : keys) {
+                hits += set.contains(key);
+            }
+            volatile size_t sink = hits;
+            (void)sink;
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::micro> duration = end - start;
+    return duration.count();
+}
+
+int main(int argc, char* argv[]) {
+    const size_t num_keys = 4000000; // well past the last-level cache
+    const size_t num_ops = 1000000;
+
+    size_t num_threads = 1;
+    if (argc >= 2) {
+        num_threads = std::stoul(argv[1]);
+    }
+    const double skew = argc >= 3 ? std::stod(argv[2]) : 0.99;
+    const bool promote = !(argc >= 4 && std::string(argv[3]) == "off");
+
+    CuckooHash hashset(num_keys / CuckooHash::slots_per_bucket);
+    for (size_t k = 0; k < num_keys; k++) hashset.add(static_cast<int>(k));
+
+    ZipfGenerator zipf(num_keys, skew);
+    std::vector<std::vector<int>> queries(num_threads);
+    std::mt19937 gen(std::random_device{}());
+    for (auto& keys : queries) {
+        for (size_t i = 0; i < num_ops / num_threads; i++) keys.push_back(zipf(gen));
+    }
+
+    // one untimed pass feeds the sampler, then a few promotion passes move the hot keys
+    time_lookups(hashset, queries);
+    size_t promoted = 0;
+    if (promote) {
+        for (int pass = 0; pass < 4; pass++) promoted += hashset.promote_hot(4096);
+    }
+
+    const int num_iter = 5;
+    double total_time = 0.0;
+
+    PerfCounters perf;
+    for (int i = 0; i < num_iter; i++) {
+        perf.start();
+        total_time += time_lookups(hashset, queries);
+        perf.stop();
+    }
+
+    std::cout << "Promoted keys: " << promoted << std::endl;
+    double avg_time = total_time / num_iter;
+    std::cout << "Average execution time (microseconds): " << avg_time << std::endl;
+    perf.report(std::cout, num_iter * (num_ops / num_threads) * num_threads);
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <algorithm>
+
+#include "cuckoo_buffered.h"
+#include "perf_counters.h"
+
+// bulk ingest of distinct keys into a presized table, one slice per thread. buffered
+// threads write through a BufferedWriter, direct threads call add() per key, and seq is
+// one thread on the single-threaded v2 table: the per-core rate the others aim for
+using CuckooHash = CuckooTable<int, 4, MixHashers<int>, StripedLock<1024, std::shared_mutex>, Pow2Storage>;
+using SeqHash = CuckooTable<int, 4, MixHashers<int>, NoLock, Pow2Storage>;
+
+template<typename Table, typename Insert>
+double ingest(const std::vector<int>& keys, size_t num_threads, PerfCounters& perf, Insert insert) {
+    const size_t keys_per_thread = keys.size() / num_threads;
+    Table hashset(keys.size() / Table::slots_per_bucket);
+    std::vector<std::thread> threads;
+    perf.start();
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t]() {
+            insert(hashset, keys.data() + t * keys_per_thread, keys_per_thread);
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    perf.stop();
+    if (hashset.size() != keys.size()) {
+        std::cerr << "Expected " << keys.size() << " keys, found " << hashset.size() << std::endl;
+    }
+    std::chrono::duration<double, std::micro> duration = end - start;
+    return duration.count();
+}
+
+int main(int argc, char* argv[]) {
+    const size_t num_keys = 4000000;
+
+    size_t num_threads = 1;
+    if (argc >= 2) {
+        num_threads = std::stoul(argv[1]);
+    }
+    const std::string mode = argc >= 3 ? argv[2] : "buffered";
+    if (mode == "seq") num_threads = 1;
+    const size_t keys_per_thread = num_keys / num_threads;
+
+    std::vector<int> keys(keys_per_thread * num_threads);
+    for (size_t i = 0; i < keys.size(); i++) keys[i] = static_cast<int>(i);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(std::random_device{}()));
+
+    const int num_iter = 5;
+    double total_time = 0.0;
+
+    PerfCounters perf;
+    for (int i = 0; i < num_iter; i++) {
+        if (mode == "seq") {
+            total_time += ingest<SeqHash>(keys, 1, perf, [](SeqHash& set, const int* k, size_t n) {
+                for (size_t j = 0; j < n; j++) set.add(k[j]);
+            });
+        } else if (mode == "direct") {
+            total_time += ingest<CuckooHash>(keys, num_threads, perf, [](CuckooHash& set, const int* k, size_t n) {
+                for (size_t j = 0; j < n; j++) set.add(k[j]);
+            });
+        } else {
+            total_time += ingest<CuckooHash>(keys, num_threads, perf, [](CuckooHash& set, const int* k, size_t n) {
+                BufferedWriter<CuckooHash> writer(set);
+                for (size_t j = 0; j < n; j++) writer.add(k[j]);
+            });
+        }
+    }
+
+    double avg_time = total_time / num_iter;
+    std::cout << "Keys per second per thread: " << keys.size() / (avg_time / 1e6) / num_threads << std::endl;
+    std::cout << "Average execution time (microseconds): " << avg_time << std::endl;
+    perf.report(std::cout, num_iter * keys.size());
+
+    return 0;
+}
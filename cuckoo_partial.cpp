@@ -0,0 +1,105 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <memory>
+
+#include "cuckoo_partial.h"
+#include "perf_counters.h"
+
+// 8M keys grown from one bucket, then uniform lookups (half hits) far beyond the TLB's reach
+using FullKey = CuckooTable<int, 4, MixHashers<int>, StripedLock<1024, std::shared_mutex>, Pow2Storage>;
+template<typename Neighbourhood>
+using Partial = PartialKeyCuckooSet<int, 4, MixHashers<int>, StripedLock<1024, std::shared_mutex>, Neighbourhood>;
+
+template<typename Set>
+void fill(Set& set, size_t num_keys, size_t num_threads) {
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < num_threads; t++) {
+        threads.emplace_back([&set, num_keys, num_threads, t]() {
+            for (size_t k = t; k < num_keys; k += num_threads) set.add(static_cast<int>(k));
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+}
+
+template<typename Set>
+double lookups(const Set& set, const std::vector<std::vector<int>>& queries) {
+    std::vector<std::thread> threads;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto& keys : queries) {
+        threads.emplace_back([&set, &keys]() {
+            size_t hits = 0;
+            for (int key : keys) {
+                hits += set.contains(key);
+            }
+            volatile size_t sink = hits;
+            (void)sink;
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::micro> duration = end - start;
+    return duration.count();
+}
+
+int main(int argc, char* argv[]) {
+    const size_t num_keys = 8000000;
+    const size_t num_ops = 1000000;
+
+    size_t num_threads = 1;
+    if (argc >= 2) {
+        num_threads = std::stoul(argv[1]);
+    }
+    const std::string engine = argc >= 3 ? argv[2] : "page";
+
+    std::vector<std::vector<int>> queries(num_threads);
+    std::mt19937 gen(std::random_device{}());
+    std::uniform_int_distribution<> keyDist(0, 2 * static_cast<int>(num_keys) - 1);
+    for (auto& keys : queries) {
+        for (size_t i = 0; i < num_ops / num_threads; i++) keys.push_back(keyDist(gen));
+    }
+
+    const int num_iter = 5;
+    double total_time = 0.0;
+    double build_time = 0.0;
+    size_t bytes = 0;
+
+    PerfCounters perf;
+    auto run = [&](auto set, auto memory) {
+        auto start = std::chrono::high_resolution_clock::now();
+        fill(*set, num_keys, num_threads);
+        std::chrono::duration<double, std::micro> built = std::chrono::high_resolution_clock::now() - start;
+        build_time = built.count();
+        bytes = memory(*set);
+        for (int i = 0; i < num_iter; i++) {
+            perf.start();
+            total_time += lookups(*set, queries);
+            perf.stop();
+        }
+    };
+
+    if (engine == "full") {
+        run(std::make_unique<FullKey>(1),
+            [](const FullKey& t) { return t.bucket_count() * 2 * (FullKey::slots_per_bucket * sizeof(int) + 1); });
+    } else if (engine == "any") {
+        run(std::make_unique<Partial<AnyBucket>>(1), [](const auto& s) { return s.memory_bytes(); });
+    } else if (engine == "lines") {
+        run(std::make_unique<Partial<NearbyLines<16>>>(1), [](const auto& s) { return s.memory_bytes(); });
+    } else {
+        run(std::make_unique<Partial<SamePage>>(1), [](const auto& s) { return s.memory_bytes(); });
+    }
+
+    std::cout << "Build with resizes (microseconds): " << build_time << ", approx bytes: " << bytes << std::endl;
+    double avg_time = total_time / num_iter;
+    std::cout << "Average execution time (microseconds): " << avg_time << std::endl;
+    perf.report(std::cout, num_iter * (num_ops / num_threads) * num_threads);
+
+    return 0;
+}
@@ -0,0 +1,430 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+#include "cuckoo_table.h"
+
+// ---------------------------------------------------------------------------
+// neighbourhoods: how far a key's second bucket may be from its first
+// ---------------------------------------------------------------------------
+
+// anywhere in the table
+struct AnyBucket {
+    static constexpr size_t bytes = 0;
+};
+
+// both buckets in the same aligned block of Bytes
+template<size_t Bytes>
+struct Within {
+    static_assert(is_pow2(Bytes), "neighbourhood size must be a power of two");
+    static constexpr size_t bytes = Bytes;
+};
+
+using SamePage = Within<4096>;
+
+template<size_t Lines>
+using NearbyLines = Within<64 * Lines>;
+
+// partial-key cuckoo set, as in MemC3 and cuckoo filters. there is one array of buckets and
+// every slot keeps a 32-bit hash word next to its key. a key's first bucket is the low bits
+// of its word, the second is the first xor an offset drawn from an 8-bit tag of the word, so
+// from either bucket the other follows from the stored word alone:
+// - displacement moves keys without hashing them, and lookups compare words before keys
+// - the offset stays inside the Neighbourhood, so both buckets share a page (or a few
+//   lines) when the bucket size is a power of two
+// - once the table is at least one neighbourhood wide, doubling sends every key of bucket
+//   b to b or b + n by one more bit of its word; keys are never rehashed and never collide
+//
+// words are 31 hash bits plus an occupied bit, which caps the table at 2^31 buckets
+template<typename Key,
+         size_t SlotsPerBucket = 4,
+         typename Hashers = MixHashers<Key>,
+         typename LockPolicy = NoLock,
+         typename Neighbourhood = SamePage>
+class PartialKeyCuckooSet {
+    static_assert(SlotsPerBucket >= 1 && SlotsPerBucket <= 32, "1..32 slots per bucket");
+
+public:
+    using key_type = Key;
+    static constexpr size_t slots_per_bucket = SlotsPerBucket;
+
+private:
+    static constexpr uint32_t OCCUPIED = 1u << 31;
+    static constexpr size_t MAX_BUCKETS = size_t{1} << 31;
+    static constexpr size_t PAGE = 4096;
+    static constexpr size_t BUCKET_ALIGN =
+        std::min<size_t>(64, next_pow2(SlotsPerBucket * (sizeof(uint32_t) + sizeof(Key))));
+
+    struct alignas(BUCKET_ALIGN) Bucket {
+        uint32_t words[SlotsPerBucket]; // 0 marks a free slot
+        Key keys[SlotsPerBucket];
+        Bucket() : words(), keys() {}
+    };
+
+    static constexpr size_t floor_pow2(size_t n) {
+        size_t p = 1;
+        while (p * 2 <= n) p *= 2;
+        return p;
+    }
+
+    // buckets per neighbourhood, 0 for the whole table
+    static constexpr size_t WINDOW =
+        Neighbourhood::bytes ? floor_pow2(std::max<size_t>(1, Neighbourhood::bytes / sizeof(Bucket))) : 0;
+    static_assert(Neighbourhood::bytes == 0 || WINDOW >= 2, "a neighbourhood must hold two buckets");
+
+    enum class Room { made, none, stale };
+
+    // page-aligned bucket array, so a neighbourhood never straddles a page
+    class Buckets {
+    public:
+        explicit Buckets(size_t n) : n(n), data(static_cast<Bucket*>(::operator new(n * sizeof(Bucket), std::align_val_t{PAGE}))) {
+            for (size_t i = 0; i < n; i++) new (data + i) Bucket();
+        }
+        ~Buckets() { release(); }
+        Buckets(Buckets&& other) noexcept : n(other.n), data(std::exchange(other.data, nullptr)) {}
+        Buckets& operator=(Buckets&& other) noexcept {
+            release();
+            n = other.n;
+            data = std::exchange(other.data, nullptr);
+            return *this;
+        }
+        Bucket& operator[](size_t i) { return data[i]; }
+        const Bucket& operator[](size_t i) const { return data[i]; }
+        size_t size() const { return n; }
+
+    private:
+        size_t n;
+        Bucket* data;
+
+        void release() {
+            if (!data) return;
+            for (size_t i = 0; i < n; i++) data[i].~Bucket();
+            ::operator delete(data, std::align_val_t{PAGE});
+        }
+    };
+
+    Buckets table;
+    size_t capacity; // buckets
+    typename LockPolicy::Counter count;
+    LockPolicy locks;
+
+    static uint32_t word_of(const Key& key) {
+        return static_cast<uint32_t>(Hashers::h1(key)) | OCCUPIED;
+    }
+
+    static size_t window(size_t n) {
+        return WINDOW ? std::min(WINDOW, n) : n;
+    }
+
+    // xor distance between a key's two buckets; depends only on the word's tag
+    static size_t offset(uint32_t word, size_t n) {
+        const uint64_t tag = (word * 0x9E3779B1u) >> 24;
+        const size_t w = window(n);
+        const size_t off = static_cast<size_t>(((tag + 1) * 0xC2B2AE3D27D4EB4Full) >> 32) & (w - 1);
+        return off ? off : (w > 1 ? 1 : 0); // keep the two buckets distinct
+    }
+
+    static size_t home(uint32_t word, size_t n) { return word & (n - 1); }
+
+    // the other bucket of a key whose word is stored in bucket b
+    static size_t other(size_t b, uint32_t word, size_t n) { return b ^ offset(word, n); }
+
+    static int find(const Bucket& b, uint32_t word, const Key& key) {
+        for (size_t s = 0; s < SlotsPerBucket; s++) {
+            if (b.words[s] == word && b.keys[s] == key) return static_cast<int>(s);
+        }
+        return -1;
+    }
+
+    static bool place(Bucket& b, uint32_t word, const Key& key) {
+        for (size_t s = 0; s < SlotsPerBucket; s++) {
+            if (!b.words[s]) {
+                b.keys[s] = key;
+                b.words[s] = word;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool full(const Bucket& b) {
+        for (size_t s = 0; s < SlotsPerBucket; s++) {
+            if (!b.words[s]) return false;
+        }
+        return true;
+    }
+
+    size_t observed_capacity() const {
+        if constexpr (LockPolicy::thread_safe) {
+            return __atomic_load_n(&capacity, __ATOMIC_RELAXED);
+        } else {
+            return capacity;
+        }
+    }
+
+    void set_capacity(size_t n) {
+        if constexpr (LockPolicy::thread_safe) {
+            __atomic_store_n(&capacity, n, __ATOMIC_RELAXED);
+        } else {
+            capacity = n;
+        }
+    }
+
+    template<bool Locked, typename F>
+    void section(bool exclusive, size_t a, size_t b, F&& f) const {
+        if constexpr (!Locked) {
+            f();
+        } else if (exclusive) {
+            locks.exclusive(a, b, f);
+        } else {
+            locks.shared(a, b, f);
+        }
+    }
+
+    // runs f(i1, i2, n) with both candidate buckets of a word locked, retrying across resizes
+    template<typename F>
+    void with_pair(bool exclusive, uint32_t word, F&& f) const {
+        while (true) {
+            const size_t n = observed_capacity();
+            const size_t i1 = home(word, n);
+            const size_t i2 = other(i1, word, n);
+            bool stale = false;
+            section<true>(exclusive, i1, i2, [&] {
+                if (capacity != n) {
+                    stale = true;
+                    return;
+                }
+                f(i1, i2, n);
+            });
+            if (!stale) return;
+        }
+    }
+
+    // moves the entry in slot s of bucket b to its other bucket if that has a free slot.
+    // any entry with the same word may be moved, the destination follows from the word
+    template<bool Locked>
+    Room relocate(size_t b, size_t s, uint32_t word, size_t alt, size_t n) {
+        Room result = Room::none;
+        section<Locked>(true, b, alt, [&] {
+            if (capacity != n) {
+                result = Room::stale;
+                return;
+            }
+            Bucket& src = table[b];
+            if (src.words[s] != word) {
+                result = full(src) ? Room::none : Room::made;
+                return;
+            }
+            if (place(table[alt], word, src.keys[s])) {
+                src.words[s] = 0;
+                result = Room::made;
+            }
+        });
+        return result;
+    }
+
+    // frees a slot in bucket b by pushing one of its entries along a cuckoo path, one
+    // pair-locked hop at a time
+    template<bool Locked>
+    Room make_room(size_t b, size_t n, size_t depth) {
+        if (depth >= MAX_MIGRATIONS) return Room::none;
+
+        uint32_t words[SlotsPerBucket];
+        bool stale = false;
+        section<Locked>(false, b, b, [&] {
+            if (capacity != n) {
+                stale = true;
+                return;
+            }
+            for (size_t s = 0; s < SlotsPerBucket; s++) words[s] = table[b].words[s];
+        });
+        if (stale) return Room::stale;
+        for (size_t s = 0; s < SlotsPerBucket; s++) {
+            if (!words[s]) return Room::made;
+        }
+
+        size_t alts[SlotsPerBucket];
+        for (size_t s = 0; s < SlotsPerBucket; s++) {
+            alts[s] = other(b, words[s], n);
+            Room r = relocate<Locked>(b, s, words[s], alts[s], n);
+            if (r != Room::none) return r;
+        }
+
+        const size_t s = (b + depth) % SlotsPerBucket;
+        Room r = make_room<Locked>(alts[s], n, depth + 1);
+        if (r != Room::made) return r;
+        return relocate<Locked>(b, s, words[s], alts[s], n);
+    }
+
+    // inserts an entry known to be absent; caller holds every lock (or there are none)
+    bool insert_unlocked(uint32_t word, const Key& key) {
+        const size_t i1 = home(word, capacity);
+        const size_t i2 = other(i1, word, capacity);
+        for (size_t attempt = 0; attempt < 2; attempt++) {
+            if (place(table[i1], word, key) || place(table[i2], word, key)) return true;
+            if (make_room<false>(i1, capacity, 0) != Room::made &&
+                make_room<false>(i2, capacity, 0) != Room::made) {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    // doubles the table; caller holds every lock. from the stored words alone: a split
+    // once the offsets stop depending on n, a reinsert while the table is narrower.
+    // the new buckets are allocated before the current ones are touched, so a throw
+    // leaves the set as it was
+    void rehash(size_t new_capacity) {
+        const size_t n = table.size();
+        while (true) {
+            if (new_capacity > MAX_BUCKETS) throw std::length_error("PartialKeyCuckooSet: too many buckets");
+            Buckets fresh(new_capacity);
+            if (new_capacity == 2 * n && window(n) == window(new_capacity)) {
+                for (size_t b = 0; b < n; b++) {
+                    for (size_t s = 0; s < SlotsPerBucket; s++) {
+                        const uint32_t word = table[b].words[s];
+                        if (!word) continue;
+                        // both buckets of the key move by the same bit, and b's slot s is
+                        // free in whichever half it lands
+                        Bucket& dst = fresh[b + (word & n)];
+                        dst.words[s] = word;
+                        dst.keys[s] = table[b].keys[s];
+                    }
+                }
+                table = std::move(fresh);
+                set_capacity(new_capacity);
+                return;
+            }
+            std::swap(table, fresh);
+            set_capacity(new_capacity);
+            if (reinsert(fresh)) return;
+            // still crowded: put the old buckets back before trying a wider table
+            std::swap(table, fresh);
+            set_capacity(n);
+            new_capacity *= 2;
+        }
+    }
+
+    bool reinsert(const Buckets& old) {
+        for (size_t b = 0; b < old.size(); b++) {
+            for (size_t s = 0; s < SlotsPerBucket; s++) {
+                const uint32_t word = old[b].words[s];
+                if (word && !insert_unlocked(word, old[b].keys[s])) return false;
+            }
+        }
+        return true;
+    }
+
+    void grow(size_t n) {
+        locks.exclusive_all([&] {
+            if (capacity == n) rehash(n * 2);
+        });
+    }
+
+public:
+    explicit PartialKeyCuckooSet(size_t num_buckets = 64)
+        : table(std::min(next_pow2(num_buckets), MAX_BUCKETS)), capacity(table.size()) {}
+
+    PartialKeyCuckooSet(const PartialKeyCuckooSet&) = delete;
+    PartialKeyCuckooSet& operator=(const PartialKeyCuckooSet&) = delete;
+
+    bool add(const Key& key) {
+        const uint32_t word = word_of(key);
+        while (true) {
+            int status = 0; // 1 inserted, -1 already present, 0 both buckets full
+            size_t n = 0, i1 = 0, i2 = 0;
+            with_pair(true, word, [&](size_t b1, size_t b2, size_t cap) {
+                n = cap;
+                i1 = b1;
+                i2 = b2;
+                if (find(table[b1], word, key) >= 0 || find(table[b2], word, key) >= 0) {
+                    status = -1;
+                } else if (place(table[b1], word, key) || place(table[b2], word, key)) {
+                    count.inc();
+                    status = 1;
+                }
+            });
+            if (status != 0) return status > 0;
+
+            Room r = make_room<true>(i1, n, 0);
+            if (r == Room::none) r = make_room<true>(i2, n, 0);
+            if (r == Room::none) grow(n);
+        }
+    }
+
+    bool remove(const Key& key) {
+        const uint32_t word = word_of(key);
+        bool removed = false;
+        with_pair(true, word, [&](size_t i1, size_t i2, size_t) {
+            for (size_t b : {i1, i2}) {
+                const int s = find(table[b], word, key);
+                if (s >= 0) {
+                    table[b].words[s] = 0;
+                    count.dec();
+                    removed = true;
+                    return;
+                }
+            }
+        });
+        return removed;
+    }
+
+    bool contains(const Key& key) const {
+        const uint32_t word = word_of(key);
+        bool found = false;
+        with_pair(false, word, [&](size_t i1, size_t i2, size_t) {
+            found = find(table[i1], word, key) >= 0 || find(table[i2], word, key) >= 0;
+        });
+        return found;
+    }
+
+    void clear() {
+        locks.exclusive_all([&] {
+            for (size_t b = 0; b < capacity; b++) table[b] = Bucket();
+            count.store(0);
+        });
+    }
+
+    size_t size() const {
+        return count.load();
+    }
+
+    size_t bucket_count() const {
+        return observed_capacity();
+    }
+
+    size_t slot_count() const {
+        return bucket_count() * SlotsPerBucket;
+    }
+
+    size_t memory_bytes() const {
+        return bucket_count() * sizeof(Bucket);
+    }
+
+    // calls f(key) for every key while holding every lock
+    template<typename F>
+    void for_each(F&& f) const {
+        locks.exclusive_all([&] {
+            for (size_t b = 0; b < capacity; b++) {
+                for (size_t s = 0; s < SlotsPerBucket; s++) {
+                    if (table[b].words[s]) f(table[b].keys[s]);
+                }
+            }
+        });
+    }
+
+    void populate(size_t n, int min = 0, int max = 1000) {
+        std::random_device rd;
+        std::mt19937 gen(rd());
+        std::uniform_int_distribution<> dist(min, max);
+        for (size_t i = 0; i < n; i++) {
+            add(static_cast<Key>(dist(gen)));
+        }
+    }
+};
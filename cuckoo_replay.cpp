@@ -0,0 +1,97 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <atomic>
+#include <cstdio>
+
+#include <unistd.h>
+
+#include "cuckoo_table.h"
+#include "cuckoo_trace.h"
+#include "perf_counters.h"
+#include "zipf.h"
+
+// replays a recorded workload trace against the v2 table, split across threads. without
+// a trace file it first records a synthetic one through the Recorded hook: a sliding
+// window of live keys where new keys are added at the head, the oldest are removed and
+// lookups favour recent keys (zipfian over the window)
+using CuckooHash = CuckooTable<int, 4, MixHashers<int>, StripedLock<1024, std::shared_mutex>, Pow2Storage>;
+
+void record_synthetic(const std::string& path, size_t recorders, size_t num_ops) {
+    const int window = 100000;
+    CuckooHash hashset(window / CuckooHash::slots_per_bucket);
+    TraceWriter writer(path, trace::HAS_THREAD | trace::HAS_TIME, sizeof(int));
+    Recorded<CuckooHash> recorded(hashset, writer);
+    for (int k = 0; k < window; k++) recorded.add(k);
+
+    std::atomic<int> head{window};
+    ZipfGenerator zipf(window, 0.99);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < recorders; t++) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 gen(static_cast<unsigned>(t) + 1);
+            std::uniform_int_distribution<> opDist(1, 100);
+            for (size_t i = 0; i < num_ops / recorders; i++) {
+                const int op = opDist(gen);
+                if (op <= 70) {
+                    recorded.contains(head.load(std::memory_order_relaxed) - 1 - zipf(gen));
+                } else if (op <= 90) {
+                    recorded.add(head.fetch_add(1, std::memory_order_relaxed));
+                } else {
+                    recorded.remove(head.load(std::memory_order_relaxed) - window);
+                }
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t num_threads = 1;
+    if (argc >= 2) {
+        num_threads = std::stoul(argv[1]);
+    }
+    std::string path = argc >= 3 ? argv[2] : "synthetic";
+    const bool paced = argc >= 4 && std::string(argv[3]) == "paced";
+
+    const bool synthetic = path == "synthetic";
+    if (synthetic) {
+        path = "/tmp/cuckoo_trace_" + std::to_string(getpid()) + ".bin";
+        record_synthetic(path, 4, 1000000);
+    }
+    TraceReader trace(path);
+    const ReplayPlan plan(trace, num_threads); // split once, outside the timed region
+
+    const int num_iter = 5;
+    double total_time = 0.0;
+    ReplayStats stats;
+    double max_lag = 0.0;
+
+    PerfCounters perf;
+    for (int i = 0; i < num_iter; i++) {
+        CuckooHash hashset(1024);
+        perf.start();
+        auto start = std::chrono::high_resolution_clock::now();
+        stats = replay(hashset, trace, plan, paced ? ReplayPace::recorded : ReplayPace::full);
+        auto end = std::chrono::high_resolution_clock::now();
+        perf.stop();
+        std::chrono::duration<double, std::micro> duration = end - start;
+        total_time += duration.count();
+        max_lag = std::max(max_lag, stats.max_lag);
+    }
+
+    std::cout << "Trace records: " << trace.size() << ", bytes per record: " << trace.record_bytes()
+              << ", replayed ops: " << stats.ops << std::endl;
+    std::cout << "Max lag behind schedule (microseconds): " << max_lag << std::endl;
+    double avg_time = total_time / num_iter;
+    std::cout << "Average execution time (microseconds): " << avg_time << std::endl;
+    perf.report(std::cout, num_iter * stats.ops);
+
+    if (synthetic) std::remove(path.c_str());
+    return 0;
+}
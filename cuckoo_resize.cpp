@@ -0,0 +1,72 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#include "cuckoo_table.h"
+#include "perf_counters.h"
+
+// insert-only load from a one-bucket table, so the run is dominated by doublings.
+// the slowest add() is the stall of the largest resize, which helpers share
+using CuckooHash = CuckooTable<int, 4, MixHashers<int>, StripedLock<1024, std::shared_mutex>, Pow2Storage>;
+
+int main(int argc, char* argv[]) {
+    const size_t num_keys = 4000000;
+
+    size_t num_threads = 1;
+    if (argc >= 2) {
+        num_threads = std::stoul(argv[1]);
+    }
+    const size_t keys_per_thread = num_keys / num_threads;
+
+    // distinct keys in random order, one slice per thread
+    std::vector<int> keys(keys_per_thread * num_threads);
+    for (size_t i = 0; i < keys.size(); i++) keys[i] = static_cast<int>(i);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(std::random_device{}()));
+
+    const int num_iter = 5;
+    double total_time = 0.0;
+    double longest_add = 0.0;
+    size_t final_buckets = 0;
+
+    PerfCounters perf;
+    for (int i = 0; i < num_iter; i++) {
+        CuckooHash hashset(1);
+        std::vector<double> slowest(num_threads, 0.0);
+
+        std::vector<std::thread> threads;
+        perf.start();
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t t = 0; t < num_threads; t++) {
+            threads.emplace_back([&hashset, &keys, &slowest, t, keys_per_thread]() {
+                double worst = 0.0;
+                for (size_t k = t * keys_per_thread; k < (t + 1) * keys_per_thread; k++) {
+                    auto before = std::chrono::steady_clock::now();
+                    hashset.add(keys[k]);
+                    std::chrono::duration<double, std::micro> took = std::chrono::steady_clock::now() - before;
+                    worst = std::max(worst, took.count());
+                }
+                slowest[t] = worst;
+            });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        perf.stop();
+        std::chrono::duration<double, std::micro> duration = end - start;
+        total_time += duration.count();
+        longest_add += *std::max_element(slowest.begin(), slowest.end());
+        final_buckets = hashset.bucket_count();
+    }
+
+    std::cout << "Final buckets: " << final_buckets << ", longest add (microseconds): "
+              << longest_add / num_iter << std::endl;
+    double avg_time = total_time / num_iter;
+    std::cout << "Average execution time (microseconds): " << avg_time << std::endl;
+    perf.report(std::cout, num_iter * keys_per_thread * num_threads);
+
+    return 0;
+}
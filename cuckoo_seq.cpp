@@ -1,114 +1,13 @@
 #include <iostream>
-#include <vector>
-#include <optional>
-#include <functional>
 #include <random>
-#include <cassert>
 #include <chrono>
-#include <cstdlib>
 
-template<typename T>
-struct Bucket {
-    std::optional<T> value;
-    int state;
-    Bucket() : value(std::nullopt), state(0) {}
-};
+#include "cuckoo_table.h"
+#include "perf_counters.h"
 
+// v1: one slot per bucket, std::hash pair, modulo reduction
 template<typename T>
-class CuckooHash {
-private:
-    std::vector<Bucket<T>> buckets;
-    size_t count;
-    size_t capacity;
-    double threshold;
-
-    // doubles capacity and reinserts elements
-    void rehash() {
-        capacity *= 2;
-        std::vector<Bucket<T>> oldBuckets = buckets;
-        buckets.clear();
-        buckets.resize(capacity);
-        count = 0;
-        for (auto& bucket : oldBuckets) {
-            if (bucket.state == 1) {
-                add(*(bucket.value));
-            }
-        }
-    }
-
-public:
-    CuckooHash(size_t num_buckets = 101, double lf = 0.5)
-        : count(0), capacity(num_buckets), threshold(lf) {
-        buckets.resize(capacity);
-    }
-    
-    bool add(const T& key) {
-        if (contains(key)) {
-            return false;
-        }
-
-        if (static_cast<double>(count + 1) / capacity > threshold) {
-            rehash();
-        }
-
-        size_t index = std::hash<T>{}(key) % capacity;
-
-        while (true) { // find the next available bucket
-            if (buckets[index].state == 0 || buckets[index].state == -1) {
-                buckets[index].value = key;
-                buckets[index].state = 1;
-                count++;
-                return true;
-            }
-            index = (index + 1) % capacity;
-        }
-
-        return false;
-    }
-    
-    bool remove(const T& key) {
-        size_t index = std::hash<T>{}(key) % capacity;
-        size_t start = index;
-
-        while (buckets[index].state != 0) { // scan to find element
-            if (buckets[index].state == 1 && *(buckets[index].value) == key) {
-                buckets[index].state = -1;
-                count--;
-                return true;
-            }
-            index = (index + 1) % capacity;
-            if (index == start) break; // element not found
-        }
-        return false;
-    }
-    
-    bool contains(const T& key) const {
-        size_t index = std::hash<T>{}(key) % capacity;
-        size_t start = index;
-
-        while (buckets[index].state != 0) {
-            if (buckets[index].state == 1 && *(buckets[index].value) == key) {
-                return true;
-            }
-            index = (index + 1) % capacity;
-            if (index == start) break;
-        }
-        return false;
-    }
-    
-    size_t size() const {
-        return count;
-    }
-    
-    void populate(size_t n, int min = 0, int max = 1000) {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<> dist(min, max);
-        for (size_t i = 0; i < n; i++) {
-            add(static_cast<T>(dist(gen)));
-        }
-    }
-};
+using CuckooHash = CuckooTable<T, 1, StdHashers<T>, NoLock, DynamicStorage>;
 
 int main() {
     const size_t num_buckets = 1000;
@@ -117,6 +16,7 @@ int main() {
     const int num_iter = 50;
     double total_time = 0.0;
 
+    PerfCounters perf;
     for (int i = 0; i < num_iter; i++) {    
         CuckooHash<int> hashset(num_buckets);
         hashset.populate(100);
@@ -127,6 +27,7 @@ int main() {
         std::uniform_int_distribution<> opDist(1, 100);
         std::uniform_int_distribution<> keyDist(0, 1000);
                 
+        perf.start();
         auto start = std::chrono::high_resolution_clock::now();
         for (size_t i = 0; i < num_ops; i++) {
             int op = opDist(gen);
@@ -146,6 +47,7 @@ int main() {
             }
         }
         auto end = std::chrono::high_resolution_clock::now();
+        perf.stop();
         std::chrono::duration<double, std::micro> duration = end - start;
         total_time += duration.count();
         
@@ -154,6 +56,7 @@ int main() {
     }
     double avg_time = total_time / num_iter;
     std::cout << "Average execution time (microseconds): " << avg_time << std::endl;
+    perf.report(std::cout, num_iter * num_ops);
         
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,41 @@
+#include <iostream>
+#include <string>
+#include <csignal>
+
+#include <pthread.h>
+
+#include "cuckoo_server.h"
+
+// serves a prefilled set over a unix socket or loopback TCP until SIGINT or SIGTERM
+using CuckooHash = CuckooTable<int, 4, MixHashers<int>, StripedLock<1024, std::shared_mutex>, Pow2Storage>;
+
+int main(int argc, char* argv[]) {
+    size_t num_threads = 1;
+    if (argc >= 2) {
+        num_threads = std::stoul(argv[1]);
+    }
+    const std::string address = argc >= 3 ? argv[2] : "unix:/tmp/cuckoo.sock";
+    const size_t num_keys = argc >= 4 ? std::stoul(argv[3]) : 1000000;
+
+    // loop threads inherit the mask, so only sigwait below sees the signals
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    CuckooHash hashset(num_keys / CuckooHash::slots_per_bucket);
+    hashset.populate(num_keys, 0, 2 * static_cast<int>(num_keys));
+
+    CuckooServer<CuckooHash> server(hashset, address, num_threads);
+    server.start();
+    std::cout << "Serving " << hashset.size() << " keys on " << address << " with " << num_threads
+              << " threads" << std::endl;
+
+    int signal = 0;
+    sigwait(&signals, &signal);
+    server.stop();
+    std::cout << "Stopped with " << hashset.size() << " keys" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,500 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "cuckoo_table.h"
+
+// ---------------------------------------------------------------------------
+// wire protocol: binary and pipelined, in host byte order since the peers share
+// a machine.
+//   request:  RequestHeader, then count keys as 64-bit integers
+//   response: ResponseHeader, then count result bytes (1 hit / added / removed, else 0)
+// a client may send any number of requests before reading. responses come back in
+// request order and echo the request's tag; a single-key call is a request of one
+// ---------------------------------------------------------------------------
+
+namespace wire {
+
+enum Op : uint8_t { CONTAINS = 1, ADD = 2, REMOVE = 3 };
+
+struct RequestHeader {
+    uint32_t tag;
+    uint8_t op;
+    uint8_t reserved[3];
+    uint32_t count;
+};
+
+struct ResponseHeader {
+    uint32_t tag;
+    uint32_t count;
+};
+
+constexpr uint32_t MAX_KEYS = 1u << 16; // per request; a larger one closes the connection
+
+[[noreturn]] inline void fail(const char* what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+struct Endpoint {
+    sockaddr_storage addr{};
+    socklen_t len = 0;
+    std::string path; // unix sockets only
+};
+
+// "unix:/path" or a bare path for a unix socket, "tcp:port" for loopback TCP
+inline Endpoint resolve(const std::string& address) {
+    Endpoint e;
+    if (address.rfind("tcp:", 0) == 0) {
+        auto* in = reinterpret_cast<sockaddr_in*>(&e.addr);
+        in->sin_family = AF_INET;
+        in->sin_port = htons(static_cast<uint16_t>(std::stoul(address.substr(4))));
+        in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        e.len = sizeof(sockaddr_in);
+        return e;
+    }
+    e.path = address.rfind("unix:", 0) == 0 ? address.substr(5) : address;
+    auto* un = reinterpret_cast<sockaddr_un*>(&e.addr);
+    if (e.path.empty() || e.path.size() >= sizeof(un->sun_path)) {
+        throw std::invalid_argument("wire: bad unix socket path '" + e.path + "'");
+    }
+    un->sun_family = AF_UNIX;
+    std::memcpy(un->sun_path, e.path.c_str(), e.path.size() + 1);
+    e.len = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + e.path.size() + 1);
+    return e;
+}
+
+inline void no_delay(int fd, const Endpoint& e) {
+    if (e.addr.ss_family != AF_INET) return;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+// non-blocking listening socket; a stale unix socket file is replaced
+inline int listen_on(const Endpoint& e) {
+    const int fd = socket(e.addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) fail("wire: socket");
+    if (e.addr.ss_family == AF_INET) {
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    } else {
+        struct stat st;
+        if (stat(e.path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) unlink(e.path.c_str());
+    }
+    if (bind(fd, reinterpret_cast<const sockaddr*>(&e.addr), e.len) != 0 || listen(fd, SOMAXCONN) != 0) {
+        const int err = errno;
+        close(fd);
+        errno = err;
+        fail("wire: bind");
+    }
+    return fd;
+}
+
+// blocking client socket
+inline int connect_to(const std::string& address) {
+    const Endpoint e = resolve(address);
+    const int fd = socket(e.addr.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) fail("wire: socket");
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&e.addr), e.len) != 0) {
+        const int err = errno;
+        close(fd);
+        errno = err;
+        fail("wire: connect");
+    }
+    no_delay(fd, e);
+    return fd;
+}
+
+inline void send_all(int fd, const void* data, size_t n) {
+    const auto* p = static_cast<const unsigned char*>(data);
+    while (n) {
+        const ssize_t w = ::send(fd, p, n, MSG_NOSIGNAL);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            fail("wire: send");
+        }
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+}
+
+inline void recv_all(int fd, void* data, size_t n) {
+    auto* p = static_cast<unsigned char*>(data);
+    while (n) {
+        const ssize_t r = ::recv(fd, p, n, 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0) fail("wire: recv");
+        if (r == 0) throw std::runtime_error("wire: connection closed");
+        p += r;
+        n -= static_cast<size_t>(r);
+    }
+}
+
+} // namespace wire
+
+// blocking client for one connection. send() and receive() are split so callers can
+// keep several requests in flight; the single-key and batch calls wait for their answer
+class CuckooClient {
+public:
+    explicit CuckooClient(const std::string& address) : fd(wire::connect_to(address)) {}
+    ~CuckooClient() { close(fd); }
+
+    CuckooClient(const CuckooClient&) = delete;
+    CuckooClient& operator=(const CuckooClient&) = delete;
+
+    void send(wire::Op op, const int64_t* keys, uint32_t n, uint32_t tag = 0) {
+        if (n > wire::MAX_KEYS) throw std::length_error("CuckooClient: too many keys in one request");
+        wire::RequestHeader h{tag, op, {0, 0, 0}, n};
+        frame.resize(sizeof(h) + n * sizeof(int64_t));
+        std::memcpy(frame.data(), &h, sizeof(h));
+        std::memcpy(frame.data() + sizeof(h), keys, n * sizeof(int64_t));
+        wire::send_all(fd, frame.data(), frame.size());
+    }
+
+    // next response in request order; results must hold the request's key count
+    uint32_t receive(bool* results) {
+        wire::ResponseHeader h;
+        wire::recv_all(fd, &h, sizeof(h));
+        frame.resize(h.count);
+        wire::recv_all(fd, frame.data(), h.count);
+        for (uint32_t i = 0; i < h.count; i++) results[i] = frame[i] != 0;
+        return h.tag;
+    }
+
+    void contains(const int64_t* keys, uint32_t n, bool* found) { call(wire::CONTAINS, keys, n, found); }
+    void add(const int64_t* keys, uint32_t n, bool* added) { call(wire::ADD, keys, n, added); }
+    void remove(const int64_t* keys, uint32_t n, bool* removed) { call(wire::REMOVE, keys, n, removed); }
+
+    bool contains(int64_t key) { return single(wire::CONTAINS, key); }
+    bool add(int64_t key) { return single(wire::ADD, key); }
+    bool remove(int64_t key) { return single(wire::REMOVE, key); }
+
+private:
+    int fd;
+    std::vector<unsigned char> frame;
+
+    void call(wire::Op op, const int64_t* keys, uint32_t n, bool* results) {
+        send(op, keys, n);
+        receive(results);
+    }
+
+    bool single(wire::Op op, int64_t key) {
+        bool result = false;
+        call(op, &key, 1, &result);
+        return result;
+    }
+};
+
+// epoll front end serving a set to other processes. every loop thread owns an epoll
+// instance and the connections it accepted; the listening socket sits in all of them
+// with EPOLLEXCLUSIVE, so a new connection wakes one loop. every complete request read
+// from a connection in one go is answered together: runs of the same op are joined into
+// one call of the set's batch API (contains_batch, add_batch, remove_batch). more than
+// one loop calls the set concurrently, so it must be thread_safe
+template<typename Set>
+class CuckooServer {
+    using Key = typename Set::key_type;
+
+public:
+    CuckooServer(Set& set, const std::string& address, size_t threads = 1)
+        : set(set), endpoint(wire::resolve(address)), loops(loop_count(threads)), listener(wire::listen_on(endpoint)) {}
+
+    ~CuckooServer() {
+        stop();
+        close(listener);
+        if (!endpoint.path.empty()) unlink(endpoint.path.c_str());
+    }
+
+    CuckooServer(const CuckooServer&) = delete;
+    CuckooServer& operator=(const CuckooServer&) = delete;
+
+    // on failure every loop started so far is stopped and its descriptors closed
+    void start() {
+        if (running) return;
+        try {
+            for (auto& loop : loops) {
+                loop.epoll = epoll_create1(EPOLL_CLOEXEC);
+                if (loop.epoll < 0) wire::fail("CuckooServer: epoll");
+                loop.wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+                if (loop.wake < 0) wire::fail("CuckooServer: eventfd");
+                watch(loop.epoll, EPOLL_CTL_ADD, loop.wake, EPOLLIN);
+                watch(loop.epoll, EPOLL_CTL_ADD, listener, EPOLLIN | EPOLLEXCLUSIVE);
+            }
+            running = true;
+            for (auto& loop : loops) loop.thread = std::thread([this, &loop] { serve(loop); });
+        } catch (...) {
+            shut_down();
+            throw;
+        }
+    }
+
+    // stops every loop and closes its connections
+    void stop() {
+        if (running) shut_down();
+    }
+
+private:
+    static constexpr size_t READ_CHUNK = 64 * 1024;
+    static constexpr size_t IN_LIMIT = 1 << 20;  // unparsed bytes read per wakeup
+    static constexpr size_t OUT_LIMIT = 1 << 20; // unsent bytes before reading pauses
+
+    struct Connection {
+        int fd;
+        uint32_t events = EPOLLIN;
+        std::vector<unsigned char> in;
+        size_t in_pos = 0;
+        std::vector<unsigned char> out;
+        size_t out_pos = 0;
+    };
+
+    // requests gathered for one batch call
+    struct Pending {
+        std::vector<wire::RequestHeader> requests;
+        std::vector<Key> keys;
+        std::unique_ptr<bool[]> results;
+        size_t results_size = 0;
+    };
+
+    struct Loop {
+        int epoll = -1;
+        int wake = -1;
+        std::thread thread;
+    };
+
+    Set& set;
+    const wire::Endpoint endpoint;
+    std::vector<Loop> loops; // before listener, so a bad thread count fails before binding
+    const int listener;
+    bool running = false;
+
+    static size_t loop_count(size_t threads) {
+        threads = std::max<size_t>(1, threads);
+        if (threads > 1 && !Set::thread_safe) {
+            throw std::invalid_argument("CuckooServer: more than one loop needs a thread_safe set");
+        }
+        return threads;
+    }
+
+    static void watch(int epoll, int op, int fd, uint32_t events) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll, op, fd, &ev) != 0) wire::fail("CuckooServer: epoll_ctl");
+    }
+
+    // wakes and joins the loops that started and closes every descriptor start() opened
+    void shut_down() {
+        for (auto& loop : loops) {
+            if (!loop.thread.joinable()) continue;
+            const uint64_t one = 1;
+            ssize_t w = write(loop.wake, &one, sizeof(one));
+            (void)w;
+        }
+        for (auto& loop : loops) {
+            if (loop.thread.joinable()) loop.thread.join();
+            if (loop.epoll >= 0) close(loop.epoll);
+            if (loop.wake >= 0) close(loop.wake);
+            loop.epoll = loop.wake = -1;
+        }
+        running = false;
+    }
+
+    void serve(Loop& loop) {
+        std::unordered_map<int, std::unique_ptr<Connection>> connections;
+        Pending pending;
+        epoll_event events[64];
+        while (true) {
+            const int n = epoll_wait(loop.epoll, events, 64, -1);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            for (int i = 0; i < n; i++) {
+                const int fd = events[i].data.fd;
+                if (fd == loop.wake) {
+                    for (auto& entry : connections) close(entry.first);
+                    return;
+                }
+                if (fd == listener) {
+                    accept_all(loop, connections);
+                    continue;
+                }
+                auto it = connections.find(fd);
+                if (it == connections.end()) continue;
+                Connection& c = *it->second;
+                bool open = !(events[i].events & EPOLLERR);
+                if (open && (events[i].events & (EPOLLIN | EPOLLHUP))) open = on_readable(c, pending);
+                if (open) open = flush(c);
+                if (open) open = update_interest(loop, c);
+                if (!open) {
+                    close(fd);
+                    connections.erase(it);
+                }
+            }
+        }
+    }
+
+    void accept_all(Loop& loop, std::unordered_map<int, std::unique_ptr<Connection>>& connections) {
+        while (true) {
+            const int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return; // EAGAIN once drained; another loop may have taken it
+            wire::no_delay(fd, endpoint);
+            auto c = std::make_unique<Connection>();
+            c->fd = fd;
+            watch(loop.epoll, EPOLL_CTL_ADD, fd, c->events);
+            connections.emplace(fd, std::move(c));
+        }
+    }
+
+    // reads what is available and answers every complete request; false once the peer
+    // has gone or sent a malformed request
+    bool on_readable(Connection& c, Pending& pending) {
+        bool open = true;
+        while (c.in.size() - c.in_pos < IN_LIMIT) {
+            const size_t old = c.in.size();
+            c.in.resize(old + READ_CHUNK);
+            const ssize_t r = ::recv(c.fd, c.in.data() + old, READ_CHUNK, 0);
+            c.in.resize(old + static_cast<size_t>(std::max<ssize_t>(r, 0)));
+            if (r > 0) continue;
+            if (r < 0 && errno == EINTR) continue;
+            open = r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+            break;
+        }
+        if (!process(c, pending)) return false;
+        if (!open) flush(c); // answer what the peer sent before it hung up
+        return open;
+    }
+
+    bool process(Connection& c, Pending& pending) {
+        size_t pos = c.in_pos;
+        while (c.in.size() - pos >= sizeof(wire::RequestHeader)) {
+            wire::RequestHeader h;
+            std::memcpy(&h, c.in.data() + pos, sizeof(h));
+            if (h.count > wire::MAX_KEYS || h.op < wire::CONTAINS || h.op > wire::REMOVE) return malformed(pending);
+            const size_t bytes = sizeof(h) + h.count * sizeof(int64_t);
+            if (c.in.size() - pos < bytes) break;
+            if (!pending.requests.empty() && pending.requests.back().op != h.op) run(c, pending);
+            const size_t first = pending.keys.size();
+            const unsigned char* p = c.in.data() + pos + sizeof(h);
+            for (uint32_t k = 0; k < h.count; k++) {
+                int64_t key;
+                std::memcpy(&key, p + k * sizeof(int64_t), sizeof(key));
+                // a narrower Key would alias wire keys that differ only in the dropped bits
+                if (!fits_key(key)) {
+                    pending.keys.resize(first);
+                    return malformed(pending);
+                }
+                pending.keys.push_back(static_cast<Key>(key));
+            }
+            pending.requests.push_back(h);
+            pos += bytes;
+        }
+        run(c, pending);
+        // keep only the partial request at the tail
+        if (pos == c.in.size()) {
+            c.in.clear();
+            c.in_pos = 0;
+        } else if (pos > c.in.size() / 2) {
+            c.in.erase(c.in.begin(), c.in.begin() + static_cast<std::ptrdiff_t>(pos));
+            c.in_pos = 0;
+        } else {
+            c.in_pos = pos;
+        }
+        return true;
+    }
+
+    // whether a wire key survives the conversion to Key; 64-bit keys take every wire key
+    static bool fits_key(int64_t key) {
+        if constexpr (sizeof(Key) >= sizeof(int64_t)) {
+            return true;
+        } else if constexpr (std::is_signed_v<Key>) {
+            return key >= static_cast<int64_t>(std::numeric_limits<Key>::min()) &&
+                   key <= static_cast<int64_t>(std::numeric_limits<Key>::max());
+        } else {
+            return key >= 0 && static_cast<uint64_t>(key) <= std::numeric_limits<Key>::max();
+        }
+    }
+
+    // drops the connection's gathered requests, which the loop would otherwise run for
+    // the next connection; always false, so the caller closes the connection
+    static bool malformed(Pending& pending) {
+        pending.requests.clear();
+        pending.keys.clear();
+        return false;
+    }
+
+    // one batch call for the gathered requests, then their responses in order
+    void run(Connection& c, Pending& pending) {
+        if (pending.requests.empty()) return;
+        const size_t n = pending.keys.size();
+        if (pending.results_size < n) {
+            pending.results = std::make_unique<bool[]>(n);
+            pending.results_size = n;
+        }
+        bool* results = pending.results.get();
+        switch (pending.requests.front().op) {
+        case wire::CONTAINS: set.contains_batch(pending.keys.data(), n, results); break;
+        case wire::ADD: set.add_batch(pending.keys.data(), n, results); break;
+        case wire::REMOVE: set.remove_batch(pending.keys.data(), n, results); break;
+        }
+        size_t k = 0;
+        for (const auto& req : pending.requests) {
+            const wire::ResponseHeader h{req.tag, req.count};
+            const size_t at = c.out.size();
+            c.out.resize(at + sizeof(h) + req.count);
+            std::memcpy(c.out.data() + at, &h, sizeof(h));
+            for (uint32_t j = 0; j < req.count; j++) c.out[at + sizeof(h) + j] = results[k++];
+        }
+        pending.requests.clear();
+        pending.keys.clear();
+    }
+
+    // sends as much of the output as the socket takes; false if the peer is gone
+    bool flush(Connection& c) {
+        while (c.out_pos < c.out.size()) {
+            const ssize_t w = ::send(c.fd, c.out.data() + c.out_pos, c.out.size() - c.out_pos, MSG_NOSIGNAL);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            c.out_pos += static_cast<size_t>(w);
+        }
+        c.out.clear();
+        c.out_pos = 0;
+        return true;
+    }
+
+    // waits for writability while output is queued, and stops reading while too much is
+    bool update_interest(Loop& loop, Connection& c) {
+        const size_t queued = c.out.size() - c.out_pos;
+        const uint32_t events = (queued < OUT_LIMIT ? uint32_t{EPOLLIN} : 0u) | (queued ? uint32_t{EPOLLOUT} : 0u);
+        if (events == c.events) return true;
+        c.events = events;
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = c.fd;
+        return epoll_ctl(loop.epoll, EPOLL_CTL_MOD, c.fd, &ev) == 0;
+    }
+};
@@ -0,0 +1,70 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <string>
+
+#include "cuckoo_table.h"
+#include "perf_counters.h"
+
+// bulk set algebra against the per-key loop it replaces
+using CuckooHash = CuckooTable<int, 4, MixHashers<int>, StripedLock<1024, std::shared_mutex>, Pow2Storage>;
+
+int main(int argc, char* argv[]) {
+    const size_t num_keys = 1000000;
+    const int key_max = 4 * static_cast<int>(num_keys); // the two inputs overlap by about a quarter
+
+    size_t num_threads = 1;
+    if (argc >= 2) {
+        num_threads = std::stoul(argv[1]);
+    }
+    std::string op = argc >= 3 ? argv[2] : "intersect";
+    const bool scalar = argc >= 4 && std::string(argv[3]) == "scalar";
+
+    CuckooHash a(num_keys / CuckooHash::slots_per_bucket);
+    CuckooHash b(num_keys / CuckooHash::slots_per_bucket);
+    a.populate(num_keys, 0, key_max);
+    b.populate(num_keys, 0, key_max);
+    std::vector<int> b_keys;
+    b.for_each([&b_keys](int key) { b_keys.push_back(key); });
+
+    const int num_iter = 5;
+    double total_time = 0.0;
+    size_t result_size = 0;
+
+    PerfCounters perf;
+    for (int i = 0; i < num_iter; i++) {
+        perf.start();
+        auto start = std::chrono::high_resolution_clock::now();
+        if (!scalar) {
+            CuckooHash result = op == "merge" ? a.merged(b, num_threads)
+                              : op == "subtract" ? a.subtracted(b, num_threads)
+                              : a.intersected(b, num_threads);
+            result_size = result.size();
+        } else {
+            // one contains()/add() call per key, each taking its own bucket locks
+            CuckooHash result(num_keys / CuckooHash::slots_per_bucket);
+            if (op == "merge") {
+                a.for_each([&result](int key) { result.add(key); });
+                for (int key : b_keys) result.add(key);
+            } else {
+                a.for_each([&](int key) {
+                    bool in_b = b.contains(key);
+                    if (in_b == (op != "subtract")) result.add(key);
+                });
+            }
+            result_size = result.size();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        perf.stop();
+        std::chrono::duration<double, std::micro> duration = end - start;
+        total_time += duration.count();
+    }
+
+    std::cout << "Result size: " << result_size << std::endl;
+    double avg_time = total_time / num_iter;
+    std::cout << "Average execution time (microseconds): " << avg_time << std::endl;
+    perf.report(std::cout, num_iter * (a.size() + b.size())); // per input key
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <new>
+#include <exception>
+#include <csignal>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "cuckoo_shared.h"
+#include "perf_counters.h"
+
+// one set in shared memory, hammered by worker processes (or threads, for comparison)
+using SharedSet = SharedCuckooSet<int, 4, MixHashers<int>, 1024>;
+
+// 80% lookups, 10% adds, 10% removes, as in the single-process benchmarks
+template<typename Set>
+void run_ops(Set& set, size_t ops, int key_max) {
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_int_distribution<> opDist(1, 100);
+    std::uniform_int_distribution<> keyDist(0, key_max);
+    for (size_t i = 0; i < ops; i++) {
+        int op = opDist(gen);
+        int key = keyDist(gen);
+        if (op <= 80) {
+            set.contains(key);
+        } else if (op <= 90) {
+            set.add(key);
+        } else {
+            set.remove(key);
+        }
+    }
+}
+
+// start line for forked workers, so the clock does not include fork or attach
+struct StartLine {
+    std::atomic<size_t> attached{0};
+    std::atomic<bool> go{false};
+    std::atomic<long> attach_ns{0};
+};
+
+// waits until every child has attached; false as soon as one has exited instead, since
+// it will never attach
+bool await_attach(const StartLine* line, size_t workers, const std::vector<pid_t>& children) {
+    while (line->attached.load() < workers) {
+        for (pid_t pid : children) {
+            if (waitpid(pid, nullptr, WNOHANG) == pid) return false;
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+void kill_all(const std::vector<pid_t>& children) {
+    for (pid_t pid : children) {
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const size_t num_keys = 1000000;
+    const size_t num_ops = 1000000;
+    const int key_max = 2 * static_cast<int>(num_keys);
+
+    size_t num_workers = 1;
+    if (argc >= 2) {
+        num_workers = std::stoul(argv[1]);
+    }
+    const bool use_threads = argc >= 3 && std::string(argv[2]) == "threads";
+    const size_t ops_per_worker = num_ops / num_workers;
+
+    // one slot per key in range; the mixed workload settles near half load and never fills it
+    const std::string name = "/cuckoo_shared_" + std::to_string(getpid());
+    SharedSet set = SharedSet::create(name, key_max / SharedSet::slots_per_bucket / 2);
+    set.populate(num_keys, 0, key_max);
+
+    void* line_mem = mmap(nullptr, sizeof(StartLine), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (line_mem == MAP_FAILED) {
+        std::cerr << "mmap failed" << std::endl;
+        return 1;
+    }
+
+    const int num_iter = 5;
+    double total_time = 0.0;
+
+    PerfCounters perf;
+    for (int i = 0; i < num_iter; i++) {
+        StartLine* line = new (line_mem) StartLine();
+        std::vector<pid_t> children;
+        std::vector<std::thread> threads;
+
+        if (use_threads) {
+            perf.start();
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t w = 0; w < num_workers; w++) {
+                threads.emplace_back([&set, ops_per_worker, key_max]() {
+                    run_ops(set, ops_per_worker, key_max);
+                });
+            }
+            for (auto& th : threads) {
+                th.join();
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            perf.stop();
+            std::chrono::duration<double, std::micro> duration = end - start;
+            total_time += duration.count();
+            continue;
+        }
+
+        for (size_t w = 0; w < num_workers; w++) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                std::cerr << "fork failed" << std::endl;
+                kill_all(children);
+                SharedSet::unlink(name);
+                return 1;
+            }
+            if (pid == 0) {
+                try {
+                    // attach by name, as an unrelated process would; the region lands at a new address
+                    auto t0 = std::chrono::steady_clock::now();
+                    SharedSet mine = SharedSet::open(name);
+                    auto t1 = std::chrono::steady_clock::now();
+                    line->attach_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+                    line->attached++;
+                    while (!line->go.load(std::memory_order_acquire)) {
+                        std::this_thread::yield();
+                    }
+                    run_ops(mine, ops_per_worker, key_max);
+                } catch (const std::exception& e) {
+                    std::cerr << "worker failed: " << e.what() << std::endl;
+                    _exit(1);
+                }
+                _exit(0);
+            }
+            children.push_back(pid);
+        }
+        if (!await_attach(line, num_workers, children)) {
+            std::cerr << "a worker exited before attaching" << std::endl;
+            kill_all(children);
+            SharedSet::unlink(name);
+            return 1;
+        }
+        // the workers inherited the counters disabled at fork; enabling them here enables
+        // theirs too, so the counters cover the same span as the clock
+        perf.start();
+        auto start = std::chrono::high_resolution_clock::now();
+        line->go.store(true, std::memory_order_release);
+        bool failed = false;
+        for (pid_t pid : children) {
+            int status = 0;
+            if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                failed = true;
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        perf.stop();
+        if (failed) {
+            std::cerr << "a worker failed" << std::endl;
+            SharedSet::unlink(name);
+            return 1;
+        }
+        std::chrono::duration<double, std::micro> duration = end - start;
+        total_time += duration.count();
+        if (i == num_iter - 1) {
+            std::cout << "Attach time per process (microseconds): "
+                      << line->attach_ns.load() / 1000.0 / num_workers << std::endl;
+        }
+    }
+
+    std::cout << "Final size: " << set.size() << ", region bytes: " << set.memory_bytes() << std::endl;
+    double avg_time = total_time / num_iter;
+    std::cout << "Average execution time (microseconds): " << avg_time << std::endl;
+    perf.report(std::cout, num_iter * ops_per_worker * num_workers);
+
+    munmap(line_mem, sizeof(StartLine));
+    SharedSet::unlink(name);
+
+    return 0;
+}
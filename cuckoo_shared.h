@@ -0,0 +1,415 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "cuckoo_table.h"
+
+// ---------------------------------------------------------------------------
+// reader/writer lock in one 32-bit word, usable from any process that maps it.
+// waiters sleep on the word with a non-private futex, so the kernel matches
+// them by physical page rather than by address space. all zero is unlocked
+// ---------------------------------------------------------------------------
+class FutexRWLock {
+public:
+    void lock() {
+        uint32_t s = state.load(std::memory_order_relaxed);
+        for (int spin = 0;; spin++) {
+            if ((s & ~WAITERS) == 0) {
+                if (state.compare_exchange_weak(s, s | WRITER, std::memory_order_acquire)) return;
+                continue;
+            }
+            s = wait(s, spin);
+        }
+    }
+
+    bool try_lock() {
+        uint32_t s = state.load(std::memory_order_relaxed);
+        while ((s & ~WAITERS) == 0) {
+            if (state.compare_exchange_weak(s, s | WRITER, std::memory_order_acquire)) return true;
+        }
+        return false;
+    }
+
+    void unlock() {
+        if (state.exchange(0, std::memory_order_release) & WAITERS) wake();
+    }
+
+    void lock_shared() {
+        uint32_t s = state.load(std::memory_order_relaxed);
+        for (int spin = 0;; spin++) {
+            if (!(s & WRITER)) {
+                if (state.compare_exchange_weak(s, s + 1, std::memory_order_acquire)) return;
+                continue;
+            }
+            s = wait(s, spin);
+        }
+    }
+
+    bool try_lock_shared() {
+        uint32_t s = state.load(std::memory_order_relaxed);
+        while (!(s & WRITER)) {
+            if (state.compare_exchange_weak(s, s + 1, std::memory_order_acquire)) return true;
+        }
+        return false;
+    }
+
+    void unlock_shared() {
+        const uint32_t old = state.fetch_sub(1, std::memory_order_release);
+        // last reader out hands the lock to whoever is sleeping on it
+        if ((old & READERS) == 1 && (old & WAITERS)) {
+            uint32_t s = WAITERS;
+            if (state.compare_exchange_strong(s, 0, std::memory_order_relaxed)) wake();
+        }
+    }
+
+private:
+    static constexpr uint32_t WRITER = 1u << 31;
+    static constexpr uint32_t WAITERS = 1u << 30;
+    static constexpr uint32_t READERS = WAITERS - 1;
+    static constexpr int SPINS = 64;
+
+    std::atomic<uint32_t> state{0};
+
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "futex word must be a plain 32-bit atomic");
+
+    uint32_t* word() { return reinterpret_cast<uint32_t*>(&state); }
+
+    // spins briefly, then flags the word and sleeps until a release changes it
+    uint32_t wait(uint32_t s, int spin) {
+        if (spin < SPINS) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+            return state.load(std::memory_order_relaxed);
+        }
+        if (!(s & WAITERS) &&
+            !state.compare_exchange_weak(s, s | WAITERS, std::memory_order_relaxed)) {
+            return s;
+        }
+        syscall(SYS_futex, word(), FUTEX_WAIT, s | WAITERS, nullptr, nullptr, 0);
+        return state.load(std::memory_order_relaxed);
+    }
+
+    void wake() {
+        syscall(SYS_futex, word(), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+};
+
+// ---------------------------------------------------------------------------
+// policies for a CuckooTable whose buckets, counter and locks sit in a mapping
+// shared between processes. the table object itself is per process and only
+// points into the mapping, which may be at a different address in each one
+// ---------------------------------------------------------------------------
+
+// where one table's buckets start in the mapping, and how many there are
+struct MappedRange {
+    void* data;
+    size_t buckets;
+};
+
+// buckets of one table: a fixed run of memory owned by the mapping
+template<typename Bucket>
+class MappedBuckets {
+public:
+    MappedBuckets(MappedRange r) : first(static_cast<Bucket*>(r.data)), n(r.buckets) {}
+
+    Bucket& operator[](size_t i) { return first[i]; }
+    const Bucket& operator[](size_t i) const { return first[i]; }
+    Bucket* data() { return first; }
+    const Bucket* data() const { return first; }
+    size_t size() const { return n; }
+    Bucket* begin() { return first; }
+    Bucket* end() { return first + n; }
+    const Bucket* begin() const { return first; }
+    const Bucket* end() const { return first + n; }
+
+private:
+    Bucket* first;
+    size_t n;
+};
+
+// power-of-two capacity fixed when the region is created: growing would need every
+// process to remap, so a full table throws std::length_error like FixedStorage
+struct MappedStorage {
+    static constexpr bool resizable = false;
+    static constexpr size_t fixed_buckets = 0;
+    template<typename Bucket> using buckets = MappedBuckets<Bucket>;
+    static constexpr size_t round(size_t n) { return next_pow2(n); }
+    static constexpr size_t reduce(size_t h, size_t n) { return h & (n - 1); }
+};
+
+// size counter kept in the mapping
+struct MappedCounter {
+    AtomicCounter* shared;
+    explicit MappedCounter(AtomicCounter& c) : shared(&c) {}
+    void inc() { shared->inc(); }
+    void dec() { shared->dec(); }
+    void store(size_t v) { shared->store(v); }
+    size_t load() const { return shared->load(); }
+};
+
+// StripedLock over FutexRWLock stripes that live in the mapping, so every process
+// takes the same stripes. a process that dies while holding a stripe leaves it locked
+template<size_t Stripes = 1024>
+class ProcessSharedLock {
+public:
+    using Locks = StripedLock<Stripes, FutexRWLock>;
+    static constexpr bool thread_safe = true;
+    static constexpr size_t stripe_count = Stripes;
+    using Counter = MappedCounter;
+
+    explicit ProcessSharedLock(Locks& l) : locks(&l) {}
+
+    template<typename F> void shared(size_t a, size_t b, F&& f) const { locks->shared(a, b, f); }
+    template<typename F> void exclusive(size_t a, size_t b, F&& f) const { locks->exclusive(a, b, f); }
+    template<typename F> void shared_many(const size_t* ids, size_t n, F&& f) const { locks->shared_many(ids, n, f); }
+    template<typename F> void exclusive_many(const size_t* ids, size_t n, F&& f) const { locks->exclusive_many(ids, n, f); }
+    template<typename F> void exclusive_all(F&& f) const { locks->exclusive_all(f); }
+    template<typename F> bool try_shared(size_t a, size_t b, F&& f) const { return locks->try_shared(a, b, f); }
+    template<typename F> bool try_exclusive(size_t a, size_t b, F&& f) const { return locks->try_exclusive(a, b, f); }
+    template<typename F> bool try_shared_many(const size_t* ids, size_t n, F&& f) const { return locks->try_shared_many(ids, n, f); }
+    template<typename F> bool try_exclusive_many(const size_t* ids, size_t n, F&& f) const { return locks->try_exclusive_many(ids, n, f); }
+
+private:
+    Locks* locks;
+};
+
+// ---------------------------------------------------------------------------
+// cuckoo set living in one shm_open or memfd region: a Header, then the buckets
+// of both tables, found through byte offsets from the start of the mapping. the
+// set is a CuckooTable on MappedStorage and ProcessSharedLock
+// ---------------------------------------------------------------------------
+template<typename Key,
+         size_t SlotsPerBucket = 4,
+         typename Hashers = MixHashers<Key>,
+         size_t Stripes = 1024>
+class SharedCuckooSet {
+    static_assert(std::is_trivially_copyable_v<Key>, "keys are stored as raw bytes in the mapping");
+
+public:
+    using key_type = Key;
+    using Table = CuckooTable<Key, SlotsPerBucket, Hashers, ProcessSharedLock<Stripes>, MappedStorage>;
+    static constexpr size_t slots_per_bucket = SlotsPerBucket;
+    static constexpr bool thread_safe = true;
+
+private:
+    using Locks = typename ProcessSharedLock<Stripes>::Locks;
+    static constexpr uint64_t MAGIC = 0x63756b6f6f736574ULL; // "cukooset"
+
+    // everything a second process needs to check that the layout matches its own
+    struct Header {
+        std::atomic<uint64_t> magic; // stored last by the creator
+        uint32_t key_size;
+        uint32_t slots;
+        uint64_t stripes;
+        uint64_t bucket_bytes;
+        uint64_t capacity; // buckets per table
+        uint64_t bytes;
+        uint64_t table_offset[2];
+        AtomicCounter count;
+        Locks locks;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "header atomics must be address-free");
+
+    // what the table is built from, see CuckooTable(Region&)
+    struct Region {
+        unsigned char* base;
+        Header& header() const { return *reinterpret_cast<Header*>(base); }
+        MappedRange table(int t) const { return {base + header().table_offset[t], header().capacity}; }
+        AtomicCounter& counter() const { return header().count; }
+        Locks& locks() const { return header().locks; }
+    };
+
+    unsigned char* base = nullptr;
+    size_t bytes = 0;
+    int fd = -1;
+    std::unique_ptr<Table> table;
+
+    Header& header() const { return *reinterpret_cast<Header*>(base); }
+
+    static size_t align_up(size_t n, size_t a) { return (n + a - 1) / a * a; }
+
+    static void fail(const char* what) {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    // maps the whole of fd; the caller decides whether to build or validate
+    void map(int file, size_t length) {
+        fd = file;
+        bytes = length;
+        void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            const int err = errno;
+            close(fd);
+            fd = -1;
+            errno = err;
+            fail("SharedCuckooSet: mmap");
+        }
+        base = static_cast<unsigned char*>(p);
+    }
+
+    void build(size_t buckets) {
+        Header* h = new (base) Header();
+        h->key_size = sizeof(Key);
+        h->slots = SlotsPerBucket;
+        h->stripes = Stripes;
+        h->bucket_bytes = Table::bucket_bytes;
+        h->capacity = buckets;
+        h->bytes = bytes;
+        h->table_offset[0] = align_up(sizeof(Header), 64);
+        h->table_offset[1] = h->table_offset[0] + align_up(buckets * Table::bucket_bytes, 64);
+        // ftruncate zero-fills, which is already an empty bucket
+        h->magic.store(MAGIC, std::memory_order_release);
+    }
+
+    void validate() {
+        if (bytes < sizeof(Header)) {
+            throw std::runtime_error("SharedCuckooSet: region too small");
+        }
+        const Header& h = header();
+        if (h.magic.load(std::memory_order_acquire) != MAGIC) {
+            throw std::runtime_error("SharedCuckooSet: region not initialized");
+        }
+        if (h.key_size != sizeof(Key) || h.slots != SlotsPerBucket || h.stripes != Stripes ||
+            h.bucket_bytes != Table::bucket_bytes || h.bytes != bytes ||
+            h.bytes != region_bytes(h.capacity)) {
+            throw std::runtime_error("SharedCuckooSet: region layout does not match this type");
+        }
+    }
+
+    void open_table() {
+        Region region{base};
+        table = std::make_unique<Table>(region);
+    }
+
+    static size_t region_bytes(size_t buckets) {
+        return align_up(sizeof(Header), 64) + 2 * align_up(buckets * Table::bucket_bytes, 64);
+    }
+
+    static SharedCuckooSet create_on(int file, size_t num_buckets, const char* what) {
+        if (file < 0) fail(what);
+        const size_t buckets = MappedStorage::round(num_buckets);
+        const size_t length = region_bytes(buckets);
+        if (ftruncate(file, static_cast<off_t>(length)) != 0) {
+            const int err = errno;
+            close(file);
+            errno = err;
+            fail("SharedCuckooSet: ftruncate");
+        }
+        SharedCuckooSet set;
+        set.map(file, length);
+        set.build(buckets);
+        set.open_table();
+        return set;
+    }
+
+    SharedCuckooSet() = default;
+
+public:
+    // creates a named POSIX shared-memory region; others attach with open(). an existing
+    // region of that name is unlinked first rather than truncated, so processes that still
+    // map it keep their pages instead of faulting
+    static SharedCuckooSet create(const std::string& name, size_t num_buckets) {
+        unlink(name);
+        return create_on(shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600), num_buckets,
+                         "SharedCuckooSet: shm_open");
+    }
+
+    // anonymous region; share it by forking or by passing fd() over a unix socket
+    static SharedCuckooSet create_anonymous(size_t num_buckets) {
+        return create_on(static_cast<int>(syscall(SYS_memfd_create, "cuckoo_set", 0)), num_buckets,
+                         "SharedCuckooSet: memfd_create");
+    }
+
+    static SharedCuckooSet open(const std::string& name) {
+        const int file = shm_open(name.c_str(), O_RDWR, 0);
+        if (file < 0) fail("SharedCuckooSet: shm_open");
+        return attach(file);
+    }
+
+    // takes ownership of fd
+    static SharedCuckooSet attach(int file) {
+        struct stat st;
+        if (fstat(file, &st) != 0) {
+            const int err = errno;
+            close(file);
+            errno = err;
+            fail("SharedCuckooSet: fstat");
+        }
+        SharedCuckooSet set;
+        set.map(file, static_cast<size_t>(st.st_size));
+        set.validate();
+        set.open_table();
+        return set;
+    }
+
+    // removes the name; processes that already mapped the region keep using it
+    static void unlink(const std::string& name) {
+        shm_unlink(name.c_str());
+    }
+
+    SharedCuckooSet(SharedCuckooSet&& other) noexcept
+        : base(other.base), bytes(other.bytes), fd(other.fd), table(std::move(other.table)) {
+        other.base = nullptr;
+        other.fd = -1;
+    }
+
+    SharedCuckooSet& operator=(SharedCuckooSet&& other) noexcept {
+        std::swap(base, other.base);
+        std::swap(bytes, other.bytes);
+        std::swap(fd, other.fd);
+        std::swap(table, other.table);
+        return *this;
+    }
+
+    SharedCuckooSet(const SharedCuckooSet&) = delete;
+    SharedCuckooSet& operator=(const SharedCuckooSet&) = delete;
+
+    ~SharedCuckooSet() {
+        table.reset();
+        if (base) munmap(base, bytes);
+        if (fd >= 0) close(fd);
+    }
+
+    bool add(const Key& key) { return table->add(key); }
+    bool remove(const Key& key) { return table->remove(key); }
+    bool contains(const Key& key) const { return table->contains(key); }
+    void clear() { table->clear(); }
+    size_t size() const { return table->size(); }
+    size_t bucket_count() const { return table->bucket_count(); }
+
+    size_t slot_count() const {
+        return 2 * table->bucket_count() * SlotsPerBucket;
+    }
+
+    size_t memory_bytes() const {
+        return bytes;
+    }
+
+    int file_descriptor() const {
+        return fd;
+    }
+
+    void populate(size_t n, int min = 0, int max = 1000) {
+        table->populate(n, min, max);
+    }
+};
@@ -0,0 +1,2043 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+constexpr size_t MAX_MIGRATIONS = 32;
+
+// ---------------------------------------------------------------------------
+// hashers: a policy exposes h1(key) and h2(key); reduction to a bucket index
+// is left to the storage policy
+// ---------------------------------------------------------------------------
+
+// 64-bit finalizer from MurmurHash3, every input bit affects every output bit
+constexpr uint64_t fmix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// hash pair of the original engines: std::hash of the key and of its complement
+template<typename Key>
+struct StdHashers {
+    static size_t h1(const Key& key) { return std::hash<Key>{}(key); }
+    static size_t h2(const Key& key) { return std::hash<Key>{}(~key); }
+};
+
+// two differently seeded mixes, safe to reduce with a mask; constexpr for integral keys
+template<typename Key>
+struct MixHashers {
+    static constexpr size_t h1(const Key& key) {
+        return static_cast<size_t>(fmix64(bits(key) ^ 0x9e3779b97f4a7c15ULL));
+    }
+    static constexpr size_t h2(const Key& key) {
+        return static_cast<size_t>(fmix64(bits(key) ^ 0xc2b2ae3d27d4eb4fULL));
+    }
+
+private:
+    static constexpr uint64_t bits(const Key& key) {
+        if constexpr (std::is_integral_v<Key>) {
+            return static_cast<uint64_t>(key);
+        } else {
+            return static_cast<uint64_t>(std::hash<Key>{}(key));
+        }
+    }
+};
+
+// ---------------------------------------------------------------------------
+// storage: how many buckets each table has, how a hash becomes an index and
+// what holds the buckets
+// ---------------------------------------------------------------------------
+
+constexpr bool is_pow2(size_t n) { return n && !(n & (n - 1)); }
+
+constexpr size_t next_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// runtime bucket count reduced with a modulo
+struct DynamicStorage {
+    static constexpr bool resizable = true;
+    static constexpr size_t fixed_buckets = 0;
+    template<typename Bucket> using buckets = std::vector<Bucket>;
+    static constexpr size_t round(size_t n) { return n ? n : 1; }
+    static constexpr size_t reduce(size_t h, size_t n) { return h % n; }
+};
+
+// runtime power-of-two bucket count reduced with a mask
+struct Pow2Storage {
+    static constexpr bool resizable = true;
+    static constexpr size_t fixed_buckets = 0;
+    template<typename Bucket> using buckets = std::vector<Bucket>;
+    static constexpr size_t round(size_t n) { return next_pow2(n); }
+    static constexpr size_t reduce(size_t h, size_t n) { return h & (n - 1); }
+};
+
+// compile-time bucket count: the reduction folds to a constant and the table never resizes
+template<size_t Buckets>
+struct FixedStorage {
+    static_assert(Buckets > 0, "FixedStorage needs at least one bucket");
+    static constexpr bool resizable = false;
+    static constexpr size_t fixed_buckets = Buckets;
+    template<typename Bucket> using buckets = std::vector<Bucket>;
+    static constexpr size_t round(size_t) { return Buckets; }
+    static constexpr size_t reduce(size_t h, size_t) {
+        if constexpr (is_pow2(Buckets)) {
+            return h & (Buckets - 1);
+        } else {
+            return h % Buckets;
+        }
+    }
+};
+
+// ---------------------------------------------------------------------------
+// lock policies: run a critical section over two buckets, a set of buckets, or the whole
+// table. lock ids are arbitrary integers, the policy maps them onto its own locks
+// ---------------------------------------------------------------------------
+
+struct PlainCounter {
+    size_t value = 0;
+    void inc() { value++; }
+    void dec() { value--; }
+    void store(size_t v) { value = v; }
+    size_t load() const { return value; }
+};
+
+struct AtomicCounter {
+    std::atomic<size_t> value{0};
+    void inc() { value.fetch_add(1, std::memory_order_relaxed); }
+    void dec() { value.fetch_sub(1, std::memory_order_relaxed); }
+    void store(size_t v) { value.store(v, std::memory_order_relaxed); }
+    size_t load() const { return value.load(std::memory_order_relaxed); }
+};
+
+// single-threaded: sections run inline
+struct NoLock {
+    static constexpr bool thread_safe = false;
+    static constexpr size_t stripe_count = 1;
+    using Counter = PlainCounter;
+
+    template<typename F> void shared(size_t, size_t, F&& f) const { f(); }
+    template<typename F> void exclusive(size_t, size_t, F&& f) const { f(); }
+    template<typename F> void shared_many(const size_t*, size_t, F&& f) const { f(); }
+    template<typename F> void exclusive_many(const size_t*, size_t, F&& f) const { f(); }
+    template<typename F> void exclusive_all(F&& f) const { f(); }
+};
+
+template<typename M, typename = void>
+struct has_lock_shared : std::false_type {};
+
+template<typename M>
+struct has_lock_shared<M, std::void_t<decltype(std::declval<M&>().lock_shared())>> : std::true_type {};
+
+// fixed pool of stripe locks; readers share the stripe when the mutex supports it
+template<size_t Stripes = 64, typename Mutex = std::mutex>
+class StripedLock {
+public:
+    static constexpr bool thread_safe = true;
+    static constexpr size_t stripe_count = Stripes; // lock id i maps to stripe i % Stripes
+    using Counter = AtomicCounter;
+
+    template<typename F>
+    void shared(size_t a, size_t b, F&& f) const {
+        if constexpr (has_lock_shared<Mutex>::value) {
+            PairGuard<true> guard(*this, a, b);
+            f();
+        } else {
+            exclusive(a, b, f);
+        }
+    }
+
+    template<typename F>
+    void exclusive(size_t a, size_t b, F&& f) const {
+        PairGuard<false> guard(*this, a, b);
+        f();
+    }
+
+    // one ordered acquisition of every stripe any of ids maps to
+    template<typename F>
+    void shared_many(const size_t* ids, size_t n, F&& f) const {
+        if constexpr (has_lock_shared<Mutex>::value) {
+            ManyGuard<true> guard(*this, ids, n);
+            f();
+        } else {
+            exclusive_many(ids, n, f);
+        }
+    }
+
+    template<typename F>
+    void exclusive_many(const size_t* ids, size_t n, F&& f) const {
+        ManyGuard<false> guard(*this, ids, n);
+        f();
+    }
+
+    template<typename F>
+    void exclusive_all(F&& f) const {
+        AllGuard guard(*this);
+        f();
+    }
+
+    // the same sections with try_lock: f() runs only if every stripe was free, and
+    // nothing is held on false. waiters that have other work use these instead of sleeping
+    template<typename F>
+    bool try_shared(size_t a, size_t b, F&& f) const {
+        if constexpr (has_lock_shared<Mutex>::value) {
+            PairGuard<true> guard(*this, a, b, std::try_to_lock);
+            if (guard.owns) f();
+            return guard.owns;
+        } else {
+            return try_exclusive(a, b, f);
+        }
+    }
+
+    template<typename F>
+    bool try_exclusive(size_t a, size_t b, F&& f) const {
+        PairGuard<false> guard(*this, a, b, std::try_to_lock);
+        if (guard.owns) f();
+        return guard.owns;
+    }
+
+    template<typename F>
+    bool try_shared_many(const size_t* ids, size_t n, F&& f) const {
+        if constexpr (has_lock_shared<Mutex>::value) {
+            ManyGuard<true> guard(*this, ids, n, std::try_to_lock);
+            if (guard.owns) f();
+            return guard.owns;
+        } else {
+            return try_exclusive_many(ids, n, f);
+        }
+    }
+
+    template<typename F>
+    bool try_exclusive_many(const size_t* ids, size_t n, F&& f) const {
+        ManyGuard<false> guard(*this, ids, n, std::try_to_lock);
+        if (guard.owns) f();
+        return guard.owns;
+    }
+
+private:
+    struct alignas(64) Stripe {
+        Mutex m;
+    };
+    mutable std::array<Stripe, Stripes> stripes;
+
+    // acquires at most two stripes in ascending order so pairs never deadlock
+    template<bool Shared>
+    struct PairGuard {
+        const StripedLock& owner;
+        size_t lo, hi;
+        bool owns = true;
+        PairGuard(const StripedLock& o, size_t a, size_t b) : owner(o) {
+            order(a, b);
+            lock(lo);
+            if (hi != lo) lock(hi);
+        }
+        PairGuard(const StripedLock& o, size_t a, size_t b, std::try_to_lock_t) : owner(o) {
+            order(a, b);
+            owns = try_lock(lo);
+            if (owns && hi != lo && !try_lock(hi)) {
+                unlock(lo);
+                owns = false;
+            }
+        }
+        ~PairGuard() {
+            if (!owns) return;
+            if (hi != lo) unlock(hi);
+            unlock(lo);
+        }
+        void order(size_t a, size_t b) {
+            a %= Stripes;
+            b %= Stripes;
+            lo = a < b ? a : b;
+            hi = a < b ? b : a;
+        }
+        void lock(size_t s) {
+            if constexpr (Shared) owner.stripes[s].m.lock_shared();
+            else owner.stripes[s].m.lock();
+        }
+        bool try_lock(size_t s) {
+            if constexpr (Shared) return owner.stripes[s].m.try_lock_shared();
+            else return owner.stripes[s].m.try_lock();
+        }
+        void unlock(size_t s) {
+            if constexpr (Shared) owner.stripes[s].m.unlock_shared();
+            else owner.stripes[s].m.unlock();
+        }
+    };
+
+    // a stripe bitmap, so stripes are deduplicated and taken in ascending order like pairs
+    template<bool Shared>
+    struct ManyGuard {
+        const StripedLock& owner;
+        uint64_t held[(Stripes + 63) / 64] = {};
+        bool owns = true;
+        ManyGuard(const StripedLock& o, const size_t* ids, size_t n) : owner(o) {
+            collect(ids, n);
+            for (size_t w = 0; w < std::size(held); w++) {
+                for (uint64_t bits = held[w]; bits; bits &= bits - 1) {
+                    Mutex& m = owner.stripes[w * 64 + static_cast<size_t>(__builtin_ctzll(bits))].m;
+                    if constexpr (Shared) m.lock_shared();
+                    else m.lock();
+                }
+            }
+        }
+        // on the first stripe that is taken, releases the ones before it
+        ManyGuard(const StripedLock& o, const size_t* ids, size_t n, std::try_to_lock_t) : owner(o) {
+            collect(ids, n);
+            for (size_t w = 0; w < std::size(held); w++) {
+                for (uint64_t bits = held[w]; bits; bits &= bits - 1) {
+                    const size_t s = w * 64 + static_cast<size_t>(__builtin_ctzll(bits));
+                    Mutex& m = owner.stripes[s].m;
+                    bool locked;
+                    if constexpr (Shared) locked = m.try_lock_shared();
+                    else locked = m.try_lock();
+                    if (locked) continue;
+                    release_below(s);
+                    owns = false;
+                    return;
+                }
+            }
+        }
+        ~ManyGuard() {
+            if (owns) release_below(Stripes);
+        }
+        void collect(const size_t* ids, size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                const size_t s = ids[i] % Stripes;
+                held[s / 64] |= uint64_t{1} << (s % 64);
+            }
+        }
+        void release_below(size_t limit) {
+            for (size_t w = 0; w < std::size(held); w++) {
+                for (uint64_t bits = held[w]; bits; bits &= bits - 1) {
+                    const size_t s = w * 64 + static_cast<size_t>(__builtin_ctzll(bits));
+                    if (s >= limit) return;
+                    Mutex& m = owner.stripes[s].m;
+                    if constexpr (Shared) m.unlock_shared();
+                    else m.unlock();
+                }
+            }
+        }
+    };
+
+    struct AllGuard {
+        const StripedLock& owner;
+        explicit AllGuard(const StripedLock& o) : owner(o) {
+            for (auto& s : owner.stripes) s.m.lock();
+        }
+        ~AllGuard() {
+            for (size_t i = Stripes; i-- > 0;) owner.stripes[i].m.unlock();
+        }
+    };
+};
+
+#ifdef __cpp_transactional_memory
+struct TransactionalCounter {
+    size_t value = 0;
+    void inc() { value++; }   // only called inside a transaction
+    void dec() { value--; }
+    void store(size_t v) { value = v; }
+    size_t load() const {
+        size_t result;
+        __transaction_atomic { result = value; }
+        return result;
+    }
+};
+
+// GNU TM (-fgnu-tm): every section is an atomic transaction, resize runs irrevocably
+struct TransactionalLock {
+    static constexpr bool thread_safe = true;
+    static constexpr size_t stripe_count = 1;
+    using Counter = TransactionalCounter;
+
+    template<typename F> void shared(size_t, size_t, F&& f) const { __transaction_atomic { f(); } }
+    template<typename F> void exclusive(size_t, size_t, F&& f) const { __transaction_atomic { f(); } }
+    template<typename F> void shared_many(const size_t*, size_t, F&& f) const { __transaction_atomic { f(); } }
+    template<typename F> void exclusive_many(const size_t*, size_t, F&& f) const { __transaction_atomic { f(); } }
+    template<typename F> void exclusive_all(F&& f) const { __transaction_relaxed { f(); } }
+};
+#endif
+
+// sections that run as transactions must not use atomics, plain writes are already isolated
+template<typename LockPolicy>
+struct runs_in_transactions : std::false_type {};
+
+#ifdef __cpp_transactional_memory
+template<>
+struct runs_in_transactions<TransactionalLock> : std::true_type {};
+#endif
+
+// ---------------------------------------------------------------------------
+// dirty tracking: the table reports every bucket it writes so a checkpointer can
+// copy only what changed, see cuckoo_checkpoint.h
+// ---------------------------------------------------------------------------
+
+struct NoDirtyTracking {
+    static constexpr bool enabled = false;
+    static constexpr size_t group_buckets = 0;
+    void reset(size_t, bool = true) {}
+    void mark_all() {}
+    template<bool Plain> void mark(int, size_t) {}
+};
+
+// one bit per group of GroupBuckets consecutive buckets of each table. marks come from
+// inside bucket-lock sections, so they race only with other marks and are atomic ors;
+// drains run under exclusive_all
+template<size_t GroupBuckets = 64>
+class DirtyGroups {
+    static_assert(GroupBuckets > 0, "groups need at least one bucket");
+
+public:
+    static constexpr bool enabled = true;
+    static constexpr size_t group_buckets = GroupBuckets;
+
+    // new layout: with whole set, the next drain reports every group
+    void reset(size_t capacity, bool whole_table = true) {
+        groups = (capacity + GroupBuckets - 1) / GroupBuckets;
+        for (auto& w : words) w.assign((groups + 63) / 64, 0);
+        whole = whole_table;
+    }
+
+    void mark_all() { whole = true; }
+
+    template<bool Plain>
+    void mark(int t, size_t bucket) {
+        const size_t g = bucket / GroupBuckets;
+        uint64_t& w = words[t][g / 64];
+        const uint64_t bit = uint64_t{1} << (g % 64);
+        if constexpr (Plain) {
+            w |= bit;
+        } else if (!(__atomic_load_n(&w, __ATOMIC_RELAXED) & bit)) {
+            // groups stay dirty across many writes; skip the locked or once set
+            __atomic_fetch_or(&w, bit, __ATOMIC_RELAXED);
+        }
+    }
+
+    // f(t, first_bucket, buckets) for every dirty group, then clears the marks; true if
+    // the whole table was reported
+    template<typename F>
+    bool drain(size_t capacity, F&& f) {
+        const bool all = whole;
+        for (int t = 0; t < 2; t++) {
+            for (size_t i = 0; i < words[t].size(); i++) {
+                uint64_t bits = all ? ~uint64_t{0} : words[t][i];
+                words[t][i] = 0;
+                while (bits) {
+                    const size_t g = i * 64 + static_cast<size_t>(__builtin_ctzll(bits));
+                    bits &= bits - 1;
+                    if (g >= groups) break;
+                    const size_t first = g * GroupBuckets;
+                    f(t, first, std::min(GroupBuckets, capacity - first));
+                }
+            }
+        }
+        whole = false;
+        return all;
+    }
+
+private:
+    std::vector<uint64_t> words[2];
+    size_t groups = 0;
+    bool whole = true;
+};
+
+// ---------------------------------------------------------------------------
+// promotion: which keys are worth moving to the front of their first-choice
+// bucket, so a lookup of a hot key reads a single bucket
+// ---------------------------------------------------------------------------
+
+struct NoPromotion {
+    static constexpr bool enabled = false;
+    void sample(uint64_t) {}
+    bool due() { return false; }
+    uint32_t heat(uint64_t) const { return 0; }
+    std::vector<uint64_t> take_hot(size_t, uint32_t) { return {}; }
+};
+
+// lossy heat table fed by one in 2^SampleShift lookups. each entry holds a key and a hit
+// count; a sample of a different key wears the resident down and takes the entry over
+// once its count runs out, so entries converge on the keys that keep coming back.
+// samples are taken outside lock sections, and saturated entries are only read
+template<size_t Entries = 4096, unsigned SampleShift = 6>
+class HotKeyPromotion {
+    static_assert(is_pow2(Entries), "entry count must be a power of two");
+
+public:
+    static constexpr bool enabled = true;
+    static constexpr uint32_t SATURATED = 1u << 16;
+    static constexpr unsigned DUE_SHIFT = 12; // promotion pass every 4096 inserts per thread
+
+    void sample(uint64_t key) {
+        thread_local uint32_t tick = 0;
+        if ((++tick & ((1u << SampleShift) - 1)) != 0) return;
+        Entry& e = entry(key);
+        if (e.key.load(std::memory_order_relaxed) == key) {
+            if (e.hits.load(std::memory_order_relaxed) < SATURATED) e.hits.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        uint32_t h = e.hits.load(std::memory_order_relaxed);
+        while (h > 0 && !e.hits.compare_exchange_weak(h, h - 1, std::memory_order_relaxed)) {
+        }
+        if (h <= 1) {
+            e.key.store(key, std::memory_order_relaxed);
+            e.hits.store(1, std::memory_order_relaxed);
+        }
+    }
+
+    // true on one insert in 2^DUE_SHIFT of the calling thread
+    bool due() {
+        thread_local uint32_t tick = 0;
+        return (++tick & ((1u << DUE_SHIFT) - 1)) == 0;
+    }
+
+    uint32_t heat(uint64_t key) const {
+        const Entry& e = entry(key);
+        return e.key.load(std::memory_order_relaxed) == key ? e.hits.load(std::memory_order_relaxed) : 0;
+    }
+
+    // up to max keys with at least min_hits, hottest first; every count is halved so
+    // that heat fades once a key stops being read
+    std::vector<uint64_t> take_hot(size_t max, uint32_t min_hits) {
+        std::vector<std::pair<uint32_t, uint64_t>> hot;
+        for (size_t i = 0; i < Entries; i++) {
+            const uint32_t h = entries[i].hits.load(std::memory_order_relaxed);
+            if (h >= min_hits) hot.emplace_back(h, entries[i].key.load(std::memory_order_relaxed));
+            entries[i].hits.store(h / 2, std::memory_order_relaxed);
+        }
+        const size_t keep = std::min(max, hot.size());
+        std::partial_sort(hot.begin(), hot.begin() + keep, hot.end(), std::greater<>());
+        std::vector<uint64_t> keys;
+        for (size_t i = 0; i < keep; i++) keys.push_back(hot[i].second);
+        return keys;
+    }
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> key{0};
+        std::atomic<uint32_t> hits{0};
+    };
+    std::unique_ptr<Entry[]> entries = std::make_unique<Entry[]>(Entries);
+
+    Entry& entry(uint64_t key) const { return entries[fmix64(key) & (Entries - 1)]; }
+};
+
+// ---------------------------------------------------------------------------
+// eviction: what a table does when an insert finds no cuckoo path. without a
+// policy it grows; with one it gives the key a resident's slot and stays bounded
+// ---------------------------------------------------------------------------
+
+struct NoEviction {
+    static constexpr bool enabled = false;
+    template<typename Plain, typename Mask> using bucket = Plain; // what a bucket holds
+    explicit NoEviction(size_t) {}
+    template<typename Bucket> static void mark(const Bucket&, int) {}
+    template<typename Bucket> static void moved(const Bucket&, size_t, const Bucket&, int) {}
+    size_t evictions() const { return 0; }
+};
+
+// CLOCK over the 2 * SlotsPerBucket slots of a key's two buckets. every slot has a
+// reference bit, set when its key is placed or found and cleared as a hand sweeps past;
+// the first clear slot goes to the new key. lookups set bits with an atomic or under the
+// shared side of the stripe locks, so readers never wait on each other. there is one
+// hand per lock stripe, moved only while that stripe is held exclusively
+class ClockEviction {
+public:
+    static constexpr bool enabled = true;
+
+    // the reference bits follow the slot mask, where buckets usually have padding
+    template<typename Plain, typename Mask>
+    struct bucket : Plain {
+        mutable std::atomic<Mask> recent{0};
+        bucket() = default;
+        bucket(const bucket& other) : Plain(other), recent(other.recent.load(std::memory_order_relaxed)) {}
+        bucket& operator=(const bucket& other) {
+            Plain::operator=(other);
+            recent.store(other.recent.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            return *this;
+        }
+    };
+
+    explicit ClockEviction(size_t stripes) : hands(std::make_unique<Hand[]>(stripes)), stripes(stripes) {}
+
+    template<typename Bucket>
+    static void mark(const Bucket& b, int s) {
+        const auto bit = static_cast<decltype(b.used)>(1u << s);
+        // skip the write when the bit is already set, hot keys stay read-shared
+        if (!(b.recent.load(std::memory_order_relaxed) & bit)) {
+            b.recent.fetch_or(bit, std::memory_order_relaxed);
+        }
+    }
+
+    // a key moved from slot s of from to slot d of to keeps its bit
+    template<typename Bucket>
+    static void moved(const Bucket& from, size_t s, const Bucket& to, int d) {
+        const auto bit = static_cast<decltype(to.used)>(1u << d);
+        if ((from.recent.load(std::memory_order_relaxed) >> s) & 1) {
+            to.recent.fetch_or(bit, std::memory_order_relaxed);
+        } else {
+            to.recent.fetch_and(static_cast<decltype(to.used)>(~bit), std::memory_order_relaxed);
+        }
+    }
+
+    // the slot to give up, 0..Slots-1 in b1 and Slots.. in b2, from the hand of stripe.
+    // the caller holds that stripe and both buckets exclusively, and both are full
+    template<size_t Slots, typename Bucket>
+    size_t victim(size_t stripe, const Bucket& b1, const Bucket& b2) {
+        constexpr size_t candidates = 2 * Slots;
+        Hand& hand = hands[stripe];
+        const size_t start = hand.next++;
+        size_t c = 0;
+        // two sweeps suffice unless readers keep re-marking slots; then take the hand's slot
+        for (size_t step = 0; step <= 2 * candidates; step++) {
+            c = (start + step) % candidates;
+            const Bucket& b = c < Slots ? b1 : b2;
+            const auto bit = static_cast<decltype(b.used)>(1u << (c % Slots));
+            if (step == 2 * candidates || !(b.recent.load(std::memory_order_relaxed) & bit)) break;
+            b.recent.fetch_and(static_cast<decltype(b.used)>(~bit), std::memory_order_relaxed);
+        }
+        hand.evicted.store(hand.evicted.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return c;
+    }
+
+    size_t evictions() const {
+        size_t total = 0;
+        for (size_t i = 0; i < stripes; i++) total += hands[i].evicted.load(std::memory_order_relaxed);
+        return total;
+    }
+
+private:
+    struct Hand {
+        size_t next = 0;                // written under the stripe lock only
+        std::atomic<size_t> evicted{0}; // read by evictions() without it
+    };
+    std::unique_ptr<Hand[]> hands;
+    size_t stripes;
+};
+
+// bucket groups copied out of a table with DirtyGroups tracking. a full delta holds every
+// group and replaces the table when applied; otherwise groups overwrite buckets in place
+struct CheckpointDelta {
+    struct Group {
+        uint32_t table;
+        uint32_t buckets;
+        uint64_t first;
+    };
+    uint64_t capacity = 0;
+    uint64_t count = 0;
+    uint32_t bucket_bytes = 0;
+    bool full = false;
+    std::vector<Group> groups;
+    std::vector<unsigned char> bytes; // the groups' buckets, back to back
+};
+
+// ---------------------------------------------------------------------------
+// the table
+// ---------------------------------------------------------------------------
+
+// read-only snapshot layouts produced by CuckooTable::freeze(), see cuckoo_frozen.h
+enum class FrozenIndex { bucketed, perfect };
+
+template<typename Key, typename Hashers>
+class FrozenCuckooSet;
+
+template<size_t Slots>
+using slot_mask_t = std::conditional_t<(Slots <= 8), uint8_t,
+                    std::conditional_t<(Slots <= 16), uint16_t, uint32_t>>;
+
+template<typename Key,
+         size_t SlotsPerBucket = 4,
+         typename Hashers = MixHashers<Key>,
+         typename LockPolicy = NoLock,
+         typename Storage = Pow2Storage,
+         typename Tracking = NoDirtyTracking,
+         typename Promotion = NoPromotion,
+         typename Eviction = NoEviction>
+class CuckooTable {
+    static_assert(SlotsPerBucket >= 1 && SlotsPerBucket <= 32, "1..32 slots per bucket");
+    static_assert(!Promotion::enabled || std::is_integral_v<Key>, "hot-key promotion samples integral keys");
+    static_assert(!Eviction::enabled || !runs_in_transactions<LockPolicy>::value,
+                  "eviction keeps atomic reference bits, which transactions cannot touch");
+    static_assert(!Eviction::enabled || !Promotion::enabled, "promotion swaps slots without their reference bits");
+
+public:
+    using key_type = Key;
+    static constexpr size_t slots_per_bucket = SlotsPerBucket;
+    static constexpr bool thread_safe = LockPolicy::thread_safe;
+
+    // one write for apply_updates(): add key, or remove it
+    struct Update {
+        Key key;
+        bool add;
+    };
+
+    struct ApplyResult {
+        size_t added = 0;   // adds of keys that were absent
+        size_t removed = 0; // removes of keys that were present
+    };
+
+private:
+    using Mask = slot_mask_t<SlotsPerBucket>;
+    static constexpr Mask FULL = static_cast<Mask>((uint64_t{1} << SlotsPerBucket) - 1);
+
+    struct PlainBucket {
+        Key keys[SlotsPerBucket];
+        Mask used;
+        PlainBucket() : keys(), used(0) {}
+    };
+    using Bucket = typename Eviction::template bucket<PlainBucket, Mask>;
+
+    enum class Room { made, none, stale };
+
+    using Buckets = typename Storage::template buckets<Bucket>;
+
+    Buckets table1;
+    Buckets table2;
+    size_t capacity; // buckets per table
+    typename LockPolicy::Counter count;
+    LockPolicy locks;
+    Tracking dirty;
+    mutable Promotion promotion;
+    Eviction eviction{LockPolicy::stripe_count};
+    static constexpr uint32_t PROMOTE_MIN_HITS = 2;
+    static constexpr size_t PROMOTE_ON_INSERT = 16; // keys per promotion pass run by add()
+
+    // ---- parallel resize: the grower holds every lock, threads that arrive meanwhile
+    // claim chunks of the old tables from a shared cursor and migrate them too ----
+
+    // transactions cannot share a half-built table with plain threads, a single-threaded
+    // table has nobody to help, and an evicting table never grows
+    static constexpr bool parallel_resize = LockPolicy::thread_safe && !runs_in_transactions<LockPolicy>::value &&
+                                            Storage::resizable && !Eviction::enabled;
+    static constexpr size_t MIGRATE_CHUNK = 1024; // old buckets of each table per claim
+    static constexpr size_t MIGRATE_LOCKS = 4096; // spin locks over destination buckets
+
+    enum MigrationState : int { IDLE, PENDING, ACTIVE, DRAINING };
+
+    struct Migration {
+        std::atomic<int> state{IDLE};
+        std::atomic<size_t> next{0}; // next unclaimed chunk
+        std::atomic<size_t> done{0}; // chunks fully migrated
+        std::atomic<size_t> helpers{0};
+        size_t chunks = 0;
+        const Bucket* from[2] = {nullptr, nullptr};
+        size_t old_capacity = 0;
+        Bucket* to[2] = {nullptr, nullptr};
+        size_t new_capacity = 0;
+        bool split = false; // every destination bucket has exactly one source bucket
+        std::unique_ptr<std::atomic<bool>[]> dest_locks;
+        std::mutex overflow_lock;
+        std::vector<Key> overflow; // keys whose two destination buckets were both full
+    };
+    mutable Migration migration;
+
+    static int find(const Bucket& b, const Key& key) {
+        for (size_t s = 0; s < SlotsPerBucket; s++) {
+            if (((b.used >> s) & 1) && b.keys[s] == key) return static_cast<int>(s);
+        }
+        return -1;
+    }
+
+    static bool place(Bucket& b, const Key& key) {
+        for (size_t s = 0; s < SlotsPerBucket; s++) {
+            if (!((b.used >> s) & 1)) {
+                b.keys[s] = key;
+                b.used |= static_cast<Mask>(1u << s);
+                Eviction::mark(b, static_cast<int>(s));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // records a write to bucket (t, i); called with that bucket locked or with no locks at all
+    void touched(int t, size_t i) {
+        dirty.template mark<!LockPolicy::thread_safe || runs_in_transactions<LockPolicy>::value>(t, i);
+    }
+
+    template<typename F>
+    static void for_each_in(const Bucket& b, F& f) {
+        for (size_t s = 0; s < SlotsPerBucket; s++) {
+            if ((b.used >> s) & 1) f(b.keys[s]);
+        }
+    }
+
+    static size_t lock_id(int t, size_t i) { return 2 * i + static_cast<size_t>(t); }
+
+    Bucket& bucket(int t, size_t i) { return t ? table2[i] : table1[i]; }
+
+    // index of key in the table other than t
+    size_t alternate(int t, const Key& key, size_t n) const {
+        return Storage::reduce(t ? Hashers::h1(key) : Hashers::h2(key), n);
+    }
+
+    // capacity as seen before taking any lock; rechecked once the section runs
+    size_t observed_capacity() const {
+        if constexpr (Storage::fixed_buckets != 0) {
+            return Storage::fixed_buckets;
+        } else if constexpr (LockPolicy::thread_safe) {
+            return __atomic_load_n(&capacity, __ATOMIC_RELAXED);
+        } else {
+            return capacity;
+        }
+    }
+
+    void set_capacity(size_t n) {
+        if constexpr (LockPolicy::thread_safe) {
+            __atomic_store_n(&capacity, n, __ATOMIC_RELAXED);
+        } else {
+            capacity = n;
+        }
+    }
+
+    template<bool Locked, typename F>
+    void section(bool exclusive, size_t a, size_t b, F&& f) const {
+        if constexpr (!Locked) {
+            f();
+        } else if constexpr (parallel_resize) {
+            while (!(exclusive ? locks.try_exclusive(a, b, f) : locks.try_shared(a, b, f))) wait_or_help();
+        } else if (exclusive) {
+            locks.exclusive(a, b, f);
+        } else {
+            locks.shared(a, b, f);
+        }
+    }
+
+    // section() over the stripes of every id in one ordered acquisition
+    template<typename F>
+    void section_many(bool exclusive, const size_t* ids, size_t n, F&& f) const {
+        if constexpr (parallel_resize) {
+            while (!(exclusive ? locks.try_exclusive_many(ids, n, f) : locks.try_shared_many(ids, n, f))) {
+                wait_or_help();
+            }
+        } else if (exclusive) {
+            locks.exclusive_many(ids, n, f);
+        } else {
+            locks.shared_many(ids, n, f);
+        }
+    }
+
+    // a lock taken while a resize can run: the stripe may belong to a grower, which holds
+    // every stripe until its migration is done, so a waiter joins the migration rather
+    // than sleep through it. otherwise it is an ordinary holder and the waiter yields
+    void wait_or_help() const {
+        if constexpr (parallel_resize) {
+            if (migration.state.load(std::memory_order_acquire) != IDLE) {
+                help_migrate();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // runs f(i1, i2, n) with both candidate buckets of a key locked, retrying across resizes
+    template<typename F>
+    void with_pair(bool exclusive, size_t h1, size_t h2, F&& f) const {
+        while (true) {
+            const size_t n = observed_capacity();
+            const size_t i1 = Storage::reduce(h1, n);
+            const size_t i2 = Storage::reduce(h2, n);
+            bool stale = false;
+            section<true>(exclusive, lock_id(0, i1), lock_id(1, i2), [&] {
+                if (capacity != n) {
+                    stale = true;
+                    return;
+                }
+                f(i1, i2, n);
+            });
+            if (!stale) return;
+        }
+    }
+
+    // moves key from slot s of bucket (t, b) to its alternate bucket if that has a free slot
+    template<bool Locked>
+    Room relocate(int t, size_t b, size_t s, const Key& key, size_t alt, size_t n) {
+        Room result = Room::none;
+        section<Locked>(true, lock_id(t, b), lock_id(1 - t, alt), [&] {
+            if (capacity != n) {
+                result = Room::stale;
+                return;
+            }
+            Bucket& src = bucket(t, b);
+            if (!((src.used >> s) & 1) || !(src.keys[s] == key)) {
+                // the slot changed under us; fine as long as the bucket has room now
+                result = src.used != FULL ? Room::made : Room::none;
+                return;
+            }
+            if (place(bucket(1 - t, alt), key)) {
+                if constexpr (Eviction::enabled) {
+                    Eviction::moved(src, s, bucket(1 - t, alt), find(bucket(1 - t, alt), key));
+                }
+                src.used &= static_cast<Mask>(~(1u << s));
+                touched(t, b);
+                touched(1 - t, alt);
+                result = Room::made;
+            }
+        });
+        return result;
+    }
+
+    // frees a slot in bucket (t, b) by pushing one of its keys along a cuckoo path.
+    // each hop locks only the two buckets it touches, so the path is found and
+    // executed without ever leaving a key unreachable
+    template<bool Locked>
+    Room make_room(int t, size_t b, size_t n, size_t depth) {
+        if (depth >= MAX_MIGRATIONS) return Room::none;
+
+        Key victims[SlotsPerBucket];
+        Mask used = 0;
+        bool stale = false;
+        section<Locked>(false, lock_id(t, b), lock_id(t, b), [&] {
+            if (capacity != n) {
+                stale = true;
+                return;
+            }
+            const Bucket& src = bucket(t, b);
+            used = src.used;
+            for (size_t s = 0; s < SlotsPerBucket; s++) victims[s] = src.keys[s];
+        });
+        if (stale) return Room::stale;
+        if (used != FULL) return Room::made;
+
+        size_t alts[SlotsPerBucket];
+        for (size_t s = 0; s < SlotsPerBucket; s++) {
+            alts[s] = alternate(t, victims[s], n);
+            Room r = relocate<Locked>(t, b, s, victims[s], alts[s], n);
+            if (r != Room::none) return r;
+        }
+
+        // no victim can move directly; clear a path behind one of them first
+        const size_t s = (b + depth) % SlotsPerBucket;
+        Room r = make_room<Locked>(1 - t, alts[s], n, depth + 1);
+        if (r != Room::made) return r;
+        return relocate<Locked>(t, b, s, victims[s], alts[s], n);
+    }
+
+    // inserts a key known to be absent; caller holds every lock (or there are none)
+    bool insert_unlocked(const Key& key) {
+        const size_t i1 = Storage::reduce(Hashers::h1(key), capacity);
+        const size_t i2 = Storage::reduce(Hashers::h2(key), capacity);
+        for (size_t attempt = 0; attempt < 2; attempt++) {
+            if (place(table1[i1], key) || place(table2[i2], key)) {
+                touched(0, i1);
+                touched(1, i2);
+                return true;
+            }
+            if (make_room<false>(0, i1, capacity, 0) != Room::made &&
+                make_room<false>(1, i2, capacity, 0) != Room::made) {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    // doubles capacity until every key fits again; caller holds every lock
+    void rehash(size_t new_capacity) {
+        Buckets old1 = std::move(table1);
+        Buckets old2 = std::move(table2);
+        while (true) {
+            table1.assign(new_capacity, Bucket());
+            table2.assign(new_capacity, Bucket());
+            set_capacity(new_capacity);
+            dirty.reset(new_capacity);
+            if (reinsert(old1) && reinsert(old2)) return;
+            new_capacity = Storage::round(new_capacity * 2);
+        }
+    }
+
+    bool reinsert(const Buckets& old) {
+        for (const auto& b : old) {
+            for (size_t s = 0; s < SlotsPerBucket; s++) {
+                if (((b.used >> s) & 1) && !insert_unlocked(b.keys[s])) return false;
+            }
+        }
+        return true;
+    }
+
+    void grow(size_t n) {
+        if constexpr (!Storage::resizable) {
+            throw std::length_error("CuckooTable: fixed capacity exhausted");
+        } else if constexpr (!parallel_resize) {
+            locks.exclusive_all([&] {
+                if (capacity == n) rehash(Storage::round(n * 2));
+            });
+        } else {
+            int idle = IDLE;
+            if (!migration.state.compare_exchange_strong(idle, PENDING)) {
+                help_migrate(); // another thread is resizing; the caller retries afterwards
+                return;
+            }
+            locks.exclusive_all([&] {
+                if (capacity == n) {
+                    parallel_rehash(Storage::round(n * 2));
+                } else {
+                    migration.state.store(IDLE);
+                }
+            });
+        }
+    }
+
+    // places a key in the destination tables under their spin locks; a key whose two
+    // buckets are both full is left for the grower's sequential pass
+    void migrate_key(const Key& key) const {
+        Migration& m = migration;
+        const size_t i1 = Storage::reduce(Hashers::h1(key), m.new_capacity);
+        const size_t i2 = Storage::reduce(Hashers::h2(key), m.new_capacity);
+        const size_t a = lock_id(0, i1) % MIGRATE_LOCKS, b = lock_id(1, i2) % MIGRATE_LOCKS;
+        const size_t lo = std::min(a, b), hi = std::max(a, b);
+        auto acquire = [&](size_t l) {
+            while (m.dest_locks[l].exchange(true, std::memory_order_acquire)) {
+                while (m.dest_locks[l].load(std::memory_order_relaxed)) std::this_thread::yield();
+            }
+        };
+        acquire(lo);
+        if (hi != lo) acquire(hi);
+        const bool placed = place(m.to[0][i1], key) || place(m.to[1][i2], key);
+        if (hi != lo) m.dest_locks[hi].store(false, std::memory_order_release);
+        m.dest_locks[lo].store(false, std::memory_order_release);
+        if (!placed) {
+            std::lock_guard<std::mutex> guard(m.overflow_lock);
+            m.overflow.push_back(key);
+        }
+    }
+
+    // claims and migrates chunks until none are left. when doubling a mask or modulo
+    // table, a key of old bucket b lands in b or b + n of the same table and nothing else
+    // lands there, so chunks own their destinations: no locks and no overflow
+    void migrate_chunks() const {
+        Migration& m = migration;
+        const size_t n = m.new_capacity;
+        while (true) {
+            const size_t c = m.next.fetch_add(1, std::memory_order_relaxed);
+            if (c >= m.chunks) return;
+            const size_t b0 = c * MIGRATE_CHUNK, b1 = std::min(m.old_capacity, b0 + MIGRATE_CHUNK);
+            for (int t = 0; t < 2; t++) {
+                for (size_t b = b0; b < b1; b++) {
+                    const Bucket& src = m.from[t][b];
+                    for (size_t s = 0; s < SlotsPerBucket; s++) {
+                        if (!((src.used >> s) & 1)) continue;
+                        const Key& key = src.keys[s];
+                        if (m.split) {
+                            // cannot fail: the destination only ever sees this bucket's keys
+                            place(m.to[t][Storage::reduce(t ? Hashers::h2(key) : Hashers::h1(key), n)], key);
+                        } else {
+                            migrate_key(key);
+                        }
+                    }
+                }
+            }
+            m.done.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    // joins a pending or running migration; returns once there is nothing left to claim.
+    // the helper count keeps the grower from retiring the migration under a helper
+    void help_migrate() const {
+        Migration& m = migration;
+        m.helpers.fetch_add(1);
+        int state;
+        while ((state = m.state.load(std::memory_order_acquire)) == PENDING) std::this_thread::yield();
+        if (state == ACTIVE) migrate_chunks();
+        m.helpers.fetch_sub(1);
+    }
+
+    // retires the migration; helpers that see DRAINING leave without touching it
+    void finish_migration() {
+        migration.state.store(DRAINING);
+        while (migration.helpers.load() != 0) std::this_thread::yield();
+        migration.state.store(IDLE);
+    }
+
+    // rehash() with the copying spread over every thread that shows up. caller holds
+    // every lock and has moved the migration to PENDING
+    void parallel_rehash(size_t new_capacity) {
+        Migration& m = migration;
+        Buckets old1 = std::move(table1);
+        Buckets old2 = std::move(table2);
+        try {
+            table1.assign(new_capacity, Bucket());
+            table2.assign(new_capacity, Bucket());
+            if (!m.dest_locks) m.dest_locks = std::make_unique<std::atomic<bool>[]>(MIGRATE_LOCKS);
+        } catch (...) {
+            table1 = std::move(old1);
+            table2 = std::move(old2);
+            finish_migration();
+            throw;
+        }
+        m.from[0] = old1.data();
+        m.from[1] = old2.data();
+        m.old_capacity = old1.size();
+        m.to[0] = table1.data();
+        m.to[1] = table2.data();
+        m.new_capacity = new_capacity;
+        m.split = new_capacity == 2 * m.old_capacity &&
+                  (std::is_same_v<Storage, Pow2Storage> || std::is_same_v<Storage, DynamicStorage>);
+        m.chunks = (m.old_capacity + MIGRATE_CHUNK - 1) / MIGRATE_CHUNK;
+        m.next.store(0, std::memory_order_relaxed);
+        m.done.store(0, std::memory_order_relaxed);
+        m.overflow.clear();
+        m.state.store(ACTIVE, std::memory_order_release);
+
+        migrate_chunks();
+        while (m.done.load(std::memory_order_acquire) < m.chunks) std::this_thread::yield();
+        finish_migration();
+
+        set_capacity(new_capacity);
+        dirty.reset(new_capacity);
+        // only keys with both destination buckets full get here; grow again if needed
+        for (const Key& key : m.overflow) {
+            while (!insert_unlocked(key)) rehash(Storage::round(capacity * 2));
+        }
+        m.overflow.clear();
+    }
+
+    // ---- hot-key promotion ----
+
+    // swaps key into slot 0 of its table1 bucket; false if it is not there or already first
+    bool to_front(size_t i1, const Key& key, size_t n) {
+        bool moved = false;
+        section<true>(true, lock_id(0, i1), lock_id(0, i1), [&] {
+            if (capacity != n) return;
+            Bucket& b = table1[i1];
+            const int s = find(b, key);
+            if (s <= 0) return;
+            // slot 0 may be empty; the used bits travel with the keys
+            const Mask first = b.used & 1;
+            std::swap(b.keys[0], b.keys[s]);
+            b.used = static_cast<Mask>((b.used & ~Mask{1} & static_cast<Mask>(~(1u << s))) | 1u |
+                                       (first << s));
+            touched(0, i1);
+            moved = true;
+        });
+        return moved;
+    }
+
+    // moves key to the front of its first-choice bucket. a full table1 bucket gives up its
+    // coldest resident to that key's table2 bucket first, if the resident is colder than
+    // key. every step is one pair-locked hop, so no key is ever unreachable
+    bool promote(const Key& key) {
+        const size_t h1 = Hashers::h1(key);
+        const size_t h2 = Hashers::h2(key);
+        int t = -1;
+        size_t s = 0, n = 0, i1 = 0, i2 = 0;
+        Key residents[SlotsPerBucket];
+        Mask used = 0;
+        with_pair(false, h1, h2, [&](size_t b1, size_t b2, size_t cap) {
+            n = cap;
+            i1 = b1;
+            i2 = b2;
+            const int s1 = find(table1[b1], key);
+            const int s2 = s1 < 0 ? find(table2[b2], key) : -1;
+            t = s1 >= 0 ? 0 : s2 >= 0 ? 1 : -1;
+            s = static_cast<size_t>(s1 >= 0 ? s1 : s2);
+            used = table1[b1].used;
+            for (size_t v = 0; v < SlotsPerBucket; v++) residents[v] = table1[b1].keys[v];
+        });
+        if (t < 0) return false;
+        if (t == 0) return to_front(i1, key, n);
+
+        if (used == FULL) {
+            size_t victim = 0;
+            uint32_t coldest = UINT32_MAX;
+            for (size_t v = 0; v < SlotsPerBucket; v++) {
+                const uint32_t h = promotion.heat(static_cast<uint64_t>(residents[v]));
+                if (h < coldest) {
+                    coldest = h;
+                    victim = v;
+                }
+            }
+            if (coldest >= promotion.heat(static_cast<uint64_t>(key))) return false;
+            const size_t alt = alternate(0, residents[victim], n);
+            Room r = relocate<true>(0, i1, victim, residents[victim], alt, n);
+            if (r == Room::none && make_room<true>(1, alt, n, 0) == Room::made) {
+                r = relocate<true>(0, i1, victim, residents[victim], alt, n);
+            }
+            if (r != Room::made) return false;
+        }
+        if (relocate<true>(1, i2, s, key, i1, n) != Room::made) return false;
+        to_front(i1, key, n);
+        return true;
+    }
+
+    // adds key to buckets (i1, i2), which the caller holds: 1 inserted, -1 already
+    // present, 0 both buckets full
+    int add_locked(const Key& key, size_t i1, size_t i2) {
+        const int s1 = find(table1[i1], key);
+        const int s2 = s1 < 0 ? find(table2[i2], key) : -1;
+        if (s1 >= 0 || s2 >= 0) {
+            Eviction::mark(s1 >= 0 ? table1[i1] : table2[i2], s1 >= 0 ? s1 : s2);
+            return -1;
+        }
+        if (!place(table1[i1], key) && !place(table2[i2], key)) return 0;
+        touched(0, i1);
+        touched(1, i2);
+        count.inc();
+        return 1;
+    }
+
+    // removes key from buckets (i1, i2), which the caller holds; false if it was absent
+    bool remove_locked(const Key& key, size_t i1, size_t i2) {
+        const int s1 = find(table1[i1], key);
+        const int s2 = s1 < 0 ? find(table2[i2], key) : -1;
+        if (s1 >= 0) {
+            table1[i1].used &= static_cast<Mask>(~(1u << s1));
+        } else if (s2 >= 0) {
+            table2[i2].used &= static_cast<Mask>(~(1u << s2));
+        } else {
+            return false;
+        }
+        touched(0, i1);
+        touched(1, i2);
+        count.dec();
+        return true;
+    }
+
+    // the promotion pass add() runs now and then, for inserted new keys; call it with
+    // no locks held
+    void after_inserts(size_t inserted) {
+        if constexpr (Promotion::enabled) {
+            bool due = false;
+            for (size_t k = 0; k < inserted; k++) due |= promotion.due();
+            if (due) promote_hot(PROMOTE_ON_INSERT);
+        }
+    }
+
+    // whether key is in buckets (i1, i2), which the caller holds at least shared; a hit
+    // counts as a use for eviction
+    bool contains_locked(const Key& key, size_t i1, size_t i2) const {
+        const int s1 = find(table1[i1], key);
+        const int s2 = s1 < 0 ? find(table2[i2], key) : -1;
+        if (s1 < 0 && s2 < 0) return false;
+        Eviction::mark(s1 >= 0 ? table1[i1] : table2[i2], s1 >= 0 ? s1 : s2);
+        return true;
+    }
+
+    // gives key the slot of the eviction policy's victim; caller holds both full buckets
+    // and the stripe of (0, i1) exclusively
+    void evict_locked(const Key& key, size_t i1, size_t i2) {
+        const size_t c = eviction.template victim<SlotsPerBucket>(lock_id(0, i1) % LockPolicy::stripe_count,
+                                                                  table1[i1], table2[i2]);
+        const int t = c < SlotsPerBucket ? 0 : 1;
+        const size_t i = t ? i2 : i1;
+        const int s = static_cast<int>(c % SlotsPerBucket);
+        bucket(t, i).keys[s] = key;
+        Eviction::mark(bucket(t, i), s);
+        touched(t, i);
+    }
+
+    // ---- grouped sections: up to GROUP keys under one ordered acquisition of their stripes ----
+
+    static constexpr size_t GROUP = 32;        // keys per acquisition, up to 64 lock ids
+    static constexpr size_t APPLY_RADIX = 256; // partitions of the bucket range per apply
+    // a striped lock partitions by stripe instead, so a group's first-choice buckets share
+    // their stripes; anything else by the high bits of the bucket, for locality
+    static constexpr size_t APPLY_PARTS = LockPolicy::stripe_count > 1 ? LockPolicy::stripe_count : APPLY_RADIX;
+
+    // runs op(j, i1, i2) for j = from, from + 1, ... < m in order, with the buckets of every
+    // one of those keys locked, until op returns false; returns the first j not done.
+    // h1 and h2 hold the keys' hashes. retries across resizes like with_pair
+    template<typename Op>
+    size_t with_group(bool exclusive, const size_t* h1, const size_t* h2, size_t from, size_t m, Op&& op) const {
+        while (true) {
+            const size_t n = observed_capacity();
+            size_t ids[2 * GROUP];
+            for (size_t j = from; j < m; j++) {
+                ids[2 * (j - from)] = lock_id(0, Storage::reduce(h1[j], n));
+                ids[2 * (j - from) + 1] = lock_id(1, Storage::reduce(h2[j], n));
+            }
+            bool stale = false;
+            size_t next = from;
+            auto run = [&] {
+                if (capacity != n) {
+                    stale = true;
+                    return;
+                }
+                // the group's buckets are all locked now, so their misses can overlap
+                for (size_t j = from; j < m; j++) {
+                    __builtin_prefetch(&table1[Storage::reduce(h1[j], n)]);
+                    __builtin_prefetch(&table2[Storage::reduce(h2[j], n)]);
+                }
+                for (; next < m; next++) {
+                    if (!op(next, Storage::reduce(h1[next], n), Storage::reduce(h2[next], n))) return;
+                }
+            };
+            if (m - from == 1) {
+                section<true>(exclusive, ids[0], ids[1], run); // a plain pair is cheaper
+            } else {
+                section_many(exclusive, ids, 2 * (m - from), run);
+            }
+            if (!stale) return next;
+        }
+    }
+
+    static void hash_group(const Key* keys, size_t m, size_t* h1, size_t* h2) {
+        for (size_t j = 0; j < m; j++) {
+            h1[j] = Hashers::h1(keys[j]);
+            h2[j] = Hashers::h2(keys[j]);
+        }
+    }
+
+    struct HashedUpdate {
+        size_t h1, h2;
+        Update u;
+    };
+
+    // applies w[0..m) in order. the section stops at an add whose two buckets are full;
+    // that add runs on its own through add(), then the rest of the group is locked again
+    void apply_group(const HashedUpdate* w, size_t m, ApplyResult& result) {
+        size_t h1[GROUP], h2[GROUP];
+        for (size_t j = 0; j < m; j++) {
+            h1[j] = w[j].h1;
+            h2[j] = w[j].h2;
+        }
+        size_t inserted = 0; // under the group's locks; add() runs its own hook
+        for (size_t done = 0; done < m;) {
+            done = with_group(true, h1, h2, done, m, [&](size_t j, size_t i1, size_t i2) {
+                if (!w[j].u.add) {
+                    result.removed += remove_locked(w[j].u.key, i1, i2);
+                    return true;
+                }
+                const int status = add_locked(w[j].u.key, i1, i2);
+                inserted += status > 0;
+                return status != 0;
+            });
+            if (done < m) result.added += add(w[done++].u.key);
+        }
+        result.added += inserted;
+        after_inserts(inserted);
+    }
+
+    // ---- bulk set operations: both tables stay fully locked, work runs unlocked ----
+
+    static constexpr size_t BATCH = 16;
+    static constexpr size_t MIN_CHUNK = 4096; // buckets per worker before threads pay off
+
+    struct SlotRef {
+        int t;
+        size_t b;
+        size_t s;
+    };
+
+    // runs f(begin, end, worker) over [0, n) in one contiguous chunk per worker
+    template<typename F>
+    static void parallel_chunks(size_t n, size_t workers, F&& f, size_t min_chunk = MIN_CHUNK) {
+        workers = std::max<size_t>(1, std::min(workers, n / min_chunk));
+        if (workers == 1) {
+            f(size_t{0}, n, size_t{0});
+            return;
+        }
+        std::vector<std::thread> threads;
+        const size_t chunk = (n + workers - 1) / workers;
+        for (size_t w = 0; w < workers; w++) {
+            const size_t begin = std::min(n, w * chunk), end = std::min(n, begin + chunk);
+            threads.emplace_back([&f, begin, end, w] { f(begin, end, w); });
+        }
+        for (auto& th : threads) th.join();
+    }
+
+    static size_t default_workers() {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // holds every lock of both tables, in address order so two bulk calls cannot deadlock
+    template<typename F>
+    void lock_with(const CuckooTable& other, F&& f) const {
+        const CuckooTable& first = this < &other ? *this : other;
+        const CuckooTable& second = this < &other ? other : *this;
+        first.locks.exclusive_all([&] { second.locks.exclusive_all(f); });
+    }
+
+    // hashes a batch, prefetches both candidate buckets of every key, then compares;
+    // emit(j, found) for each keys[j]. caller holds the locks
+    template<typename Emit>
+    void probe_unlocked(const Key* keys, size_t m, Emit&& emit) const {
+        size_t i1[BATCH], i2[BATCH];
+        for (size_t j = 0; j < m; j++) {
+            i1[j] = Storage::reduce(Hashers::h1(keys[j]), capacity);
+            i2[j] = Storage::reduce(Hashers::h2(keys[j]), capacity);
+            __builtin_prefetch(&table1[i1[j]]);
+            __builtin_prefetch(&table2[i2[j]]);
+        }
+        for (size_t j = 0; j < m; j++) {
+            emit(j, find(table1[i1[j]], keys[j]) >= 0 || find(table2[i2[j]], keys[j]) >= 0);
+        }
+    }
+
+    // pulls both candidate buckets of keys[0..m) towards the cache. caller holds the
+    // locks, or there are none
+    void prefetch_unlocked(const Key* keys, size_t m) const {
+        for (size_t j = 0; j < m; j++) {
+            __builtin_prefetch(&table1[Storage::reduce(Hashers::h1(keys[j]), capacity)]);
+            __builtin_prefetch(&table2[Storage::reduce(Hashers::h2(keys[j]), capacity)]);
+        }
+    }
+
+    // probes every key of buckets [b0, b1) of both tables against probe;
+    // f(ref, key, found) in bucket order
+    template<typename F>
+    void scan_against(const CuckooTable& probe, size_t b0, size_t b1, F&& f) const {
+        Key keys[BATCH];
+        SlotRef refs[BATCH];
+        size_t m = 0;
+        auto flush = [&] {
+            probe.probe_unlocked(keys, m, [&](size_t j, bool found) { f(refs[j], keys[j], found); });
+            m = 0;
+        };
+        for (int t = 0; t < 2; t++) {
+            const Buckets& table = t ? table2 : table1;
+            for (size_t b = b0; b < b1; b++) {
+                for (size_t s = 0; s < SlotsPerBucket; s++) {
+                    if (!((table[b].used >> s) & 1)) continue;
+                    keys[m] = table[b].keys[s];
+                    refs[m] = SlotRef{t, b, s};
+                    if (++m == BATCH) flush();
+                }
+            }
+        }
+        if (m) flush();
+    }
+
+    // slot holding a key known to be present; caller holds the locks
+    SlotRef locate_unlocked(const Key& key) const {
+        const size_t i1 = Storage::reduce(Hashers::h1(key), capacity);
+        const int s1 = find(table1[i1], key);
+        if (s1 >= 0) return SlotRef{0, i1, static_cast<size_t>(s1)};
+        const size_t i2 = Storage::reduce(Hashers::h2(key), capacity);
+        return SlotRef{1, i2, static_cast<size_t>(find(table2[i2], key))};
+    }
+
+    // not marked dirty: parallel callers mark the whole table instead
+    void clear_slot(const SlotRef& ref) {
+        bucket(ref.t, ref.b).used &= static_cast<Mask>(~(1u << ref.s));
+    }
+
+    using Bins = std::vector<std::vector<std::vector<Key>>>;
+
+    // keys of other whose presence in this table equals keep_found, binned per worker by
+    // the table1 bucket range they will land in. caller holds the locks of both tables
+    Bins collect_from(const CuckooTable& other, bool keep_found, size_t workers) const {
+        const size_t ranges = std::max<size_t>(1, std::min(workers, capacity / MIN_CHUNK));
+        const size_t span = (capacity + ranges - 1) / ranges;
+        Bins bins(workers, std::vector<std::vector<Key>>(ranges));
+        other.parallel_chunks(other.capacity, workers, [&](size_t b0, size_t b1, size_t w) {
+            other.scan_against(*this, b0, b1, [&](const SlotRef&, const Key& key, bool found) {
+                if (found != keep_found) return;
+                const size_t i1 = Storage::reduce(Hashers::h1(key), capacity);
+                bins[w][std::min(ranges - 1, i1 / span)].push_back(key);
+            });
+        });
+        return bins;
+    }
+
+    // inserts keys known to be absent. bins[w][r] holds keys whose table1 bucket falls in
+    // range r, so each worker fills a disjoint bucket range of table1, then of table2;
+    // only what is left over goes through the sequential cuckoo path. caller holds the locks
+    void bulk_insert(Bins& bins, size_t workers) {
+        dirty.mark_all(); // workers write anywhere in their ranges, too many to mark one by one
+        const size_t ranges = bins.empty() ? 1 : bins[0].size();
+        const size_t span = (capacity + ranges - 1) / ranges;
+        size_t inserted = 0;
+
+        for (int t = 0; t < 2; t++) {
+            Bins spill(ranges, std::vector<std::vector<Key>>(ranges));
+            std::vector<size_t> placed(ranges, 0);
+            parallel_chunks(ranges, workers, [&](size_t r0, size_t r1, size_t) {
+                for (size_t r = r0; r < r1; r++) {
+                    for (auto& from : bins) {
+                        for (const Key& key : from[r]) {
+                            const size_t h = t ? Hashers::h2(key) : Hashers::h1(key);
+                            if (place(bucket(t, Storage::reduce(h, capacity)), key)) {
+                                placed[r]++;
+                            } else {
+                                // next pass is binned by the table2 bucket
+                                const size_t alt = Storage::reduce(Hashers::h2(key), capacity);
+                                spill[r][std::min(ranges - 1, alt / span)].push_back(key);
+                            }
+                        }
+                    }
+                }
+            }, 1);
+            for (size_t p : placed) inserted += p;
+            bins = std::move(spill);
+        }
+
+        for (auto& from : bins) {
+            for (auto& keys : from) {
+                for (const Key& key : keys) {
+                    while (!insert_unlocked(key)) {
+                        if constexpr (!Storage::resizable) {
+                            throw std::length_error("CuckooTable: fixed capacity exhausted");
+                        } else {
+                            rehash(Storage::round(capacity * 2));
+                        }
+                    }
+                    inserted++;
+                }
+            }
+        }
+        count.store(count.load() + inserted);
+    }
+
+    // grows ahead of a bulk insert so the table stays under half full; caller holds the locks
+    void reserve_unlocked(size_t keys) {
+        if constexpr (Storage::resizable) {
+            const size_t needed = keys / SlotsPerBucket + 1; // 2 tables at most half full
+            if (needed > capacity) rehash(Storage::round(needed));
+        }
+    }
+
+    // copy of other's buckets, taken under its locks
+    struct CloneTag {};
+    CuckooTable(CloneTag, const CuckooTable& other) : capacity(0) {
+        other.locks.exclusive_all([&] {
+            table1 = other.table1;
+            table2 = other.table2;
+            capacity = other.capacity;
+            count.store(other.count.load());
+        });
+        dirty.reset(capacity);
+    }
+
+public:
+    explicit CuckooTable(size_t num_buckets = 64)
+        : table1(Storage::round(num_buckets)), table2(Storage::round(num_buckets)),
+          capacity(Storage::round(num_buckets)) {
+        dirty.reset(capacity);
+    }
+
+    // a table over buckets, a counter and locks that live somewhere else, such as a shared
+    // mapping. region.table(t) builds the storage policy's buckets of table t, and
+    // region.counter() and region.locks() build the lock policy's counter and locks
+    template<typename Region, typename = decltype(std::declval<Region&>().locks())>
+    explicit CuckooTable(Region& region)
+        : table1(region.table(0)), table2(region.table(1)), capacity(table1.size()),
+          count(region.counter()), locks(region.locks()) {
+        dirty.reset(capacity);
+    }
+
+    CuckooTable(const CuckooTable&) = delete;
+    CuckooTable& operator=(const CuckooTable&) = delete;
+
+    // not thread-safe on the source: it must not be in use
+    CuckooTable(CuckooTable&& other)
+        : table1(std::move(other.table1)), table2(std::move(other.table2)), capacity(other.capacity) {
+        count.store(other.count.load());
+        other.table1.assign(capacity, Bucket());
+        other.table2.assign(capacity, Bucket());
+        other.count.store(0);
+        dirty.reset(capacity);
+        other.dirty.reset(capacity);
+    }
+
+    // true if key was new. with an eviction policy a key that finds no cuckoo path takes
+    // a resident's slot instead of growing the table, and still counts as added
+    bool add(const Key& key) {
+        const size_t h1 = Hashers::h1(key);
+        const size_t h2 = Hashers::h2(key);
+        // a nearly full evicting table rarely has a path, and looking costs lock round trips
+        bool evict = Eviction::enabled && count.load() >= slot_count() - slot_count() / 16;
+        while (true) {
+            int status = 0; // 1 inserted, -1 already present, 0 both buckets full
+            size_t n = 0, i1 = 0, i2 = 0;
+            with_pair(true, h1, h2, [&](size_t b1, size_t b2, size_t cap) {
+                n = cap;
+                i1 = b1;
+                i2 = b2;
+                status = add_locked(key, b1, b2);
+                if constexpr (Eviction::enabled) {
+                    if (status == 0 && evict) {
+                        evict_locked(key, b1, b2);
+                        status = 1;
+                    }
+                }
+            });
+            if (status != 0) {
+                if (status > 0) after_inserts(1);
+                return status > 0;
+            }
+
+            Room r = make_room<true>(0, i1, n, 0);
+            if (r == Room::none) r = make_room<true>(1, i2, n, 0);
+            if (r == Room::none) {
+                if constexpr (Eviction::enabled) {
+                    evict = true;
+                } else {
+                    grow(n);
+                }
+            }
+        }
+    }
+
+    bool remove(const Key& key) {
+        bool removed = false;
+        with_pair(true, Hashers::h1(key), Hashers::h2(key), [&](size_t i1, size_t i2, size_t) {
+            removed = remove_locked(key, i1, i2);
+        });
+        return removed;
+    }
+
+    bool contains(const Key& key) const {
+        bool found = false;
+        with_pair(false, Hashers::h1(key), Hashers::h2(key), [&](size_t i1, size_t i2, size_t) {
+            found = contains_locked(key, i1, i2);
+        });
+        if constexpr (Promotion::enabled) {
+            if (found) promotion.sample(static_cast<uint64_t>(key));
+        }
+        return found;
+    }
+
+    // moves up to max_keys of the most-read keys to the front of their first-choice
+    // bucket and returns how many moved. add() runs a short pass now and then; call it
+    // from a background thread for more
+    size_t promote_hot(size_t max_keys = 256) {
+        static_assert(Promotion::enabled, "promote_hot needs a HotKeyPromotion policy");
+        size_t moved = 0;
+        for (uint64_t bits : promotion.take_hot(max_keys, PROMOTE_MIN_HITS)) {
+            moved += promote(static_cast<Key>(bits));
+        }
+        return moved;
+    }
+
+    void clear() {
+        locks.exclusive_all([&] {
+            for (auto& b : table1) b.used = 0;
+            for (auto& b : table2) b.used = 0;
+            count.store(0);
+            dirty.mark_all();
+        });
+    }
+
+    size_t size() const {
+        return count.load();
+    }
+
+    // calls f(key) for every key while holding every lock
+    template<typename F>
+    void for_each(F&& f) const {
+        locks.exclusive_all([&] {
+            for (const auto& b : table1) for_each_in(b, f);
+            for (const auto& b : table2) for_each_in(b, f);
+        });
+    }
+
+    // lookups for keys[0..n) into found[0..n); single-threaded tables probe in
+    // prefetched batches, locked and evicting tables lock the buckets of GROUP keys at a
+    // time, so hits count as uses
+    void contains_batch(const Key* keys, size_t n, bool* found) const {
+        if constexpr (!LockPolicy::thread_safe && !Eviction::enabled) {
+            for (size_t i = 0; i < n; i += BATCH) {
+                probe_unlocked(keys + i, std::min(BATCH, n - i), [&](size_t j, bool hit) { found[i + j] = hit; });
+            }
+        } else {
+            for (size_t i = 0; i < n; i += GROUP) {
+                const size_t m = std::min(GROUP, n - i);
+                size_t h1[GROUP], h2[GROUP];
+                hash_group(keys + i, m, h1, h2);
+                with_group(false, h1, h2, 0, m, [&](size_t j, size_t i1, size_t i2) {
+                    found[i + j] = contains_locked(keys[i + j], i1, i2);
+                    return true;
+                });
+                if constexpr (Promotion::enabled) {
+                    for (size_t j = 0; j < m; j++) {
+                        if (found[i + j]) promotion.sample(static_cast<uint64_t>(keys[i + j]));
+                    }
+                }
+            }
+        }
+    }
+
+    // adds keys[0..n), added[i] set if keys[i] was new. single-threaded tables prefetch
+    // both buckets of a window of keys before inserting them; locked tables lock the
+    // buckets of GROUP keys at a time, and a key whose buckets are both full goes
+    // through add() on its own
+    void add_batch(const Key* keys, size_t n, bool* added) {
+        if constexpr (!LockPolicy::thread_safe) {
+            for (size_t i = 0; i < n; i += BATCH) {
+                const size_t m = std::min(BATCH, n - i);
+                prefetch_unlocked(keys + i, m);
+                for (size_t j = 0; j < m; j++) added[i + j] = add(keys[i + j]);
+            }
+        } else {
+            for (size_t i = 0; i < n; i += GROUP) {
+                const size_t m = std::min(GROUP, n - i);
+                size_t h1[GROUP], h2[GROUP];
+                hash_group(keys + i, m, h1, h2);
+                size_t inserted = 0;
+                for (size_t done = 0; done < m;) {
+                    done = with_group(true, h1, h2, done, m, [&](size_t j, size_t i1, size_t i2) {
+                        const int status = add_locked(keys[i + j], i1, i2);
+                        added[i + j] = status > 0;
+                        inserted += status > 0;
+                        return status != 0;
+                    });
+                    if (done < m) {
+                        added[i + done] = add(keys[i + done]);
+                        done++;
+                    }
+                }
+                after_inserts(inserted);
+            }
+        }
+    }
+
+    // removes keys[0..n), removed[i] set if keys[i] was present
+    void remove_batch(const Key* keys, size_t n, bool* removed) {
+        if constexpr (!LockPolicy::thread_safe) {
+            for (size_t i = 0; i < n; i += BATCH) {
+                const size_t m = std::min(BATCH, n - i);
+                prefetch_unlocked(keys + i, m);
+                for (size_t j = 0; j < m; j++) removed[i + j] = remove(keys[i + j]);
+            }
+        } else {
+            for (size_t i = 0; i < n; i += GROUP) {
+                const size_t m = std::min(GROUP, n - i);
+                size_t h1[GROUP], h2[GROUP];
+                hash_group(keys + i, m, h1, h2);
+                with_group(true, h1, h2, 0, m, [&](size_t j, size_t i1, size_t i2) {
+                    removed[i + j] = remove_locked(keys[i + j], i1, i2);
+                    return true;
+                });
+            }
+        }
+    }
+
+    // applies updates[0..n) in order, as add() and remove() would. they are partitioned by
+    // the lock stripe of their first-choice bucket (the bucket's high bits without stripes),
+    // then applied in groups of GROUP, each group taking every stripe lock it needs in one
+    // ordered acquisition. second buckets are independent of the first, so those still
+    // take about one stripe per update
+    ApplyResult apply_updates(const Update* updates, size_t n) {
+        ApplyResult result;
+        if (n == 0) return result;
+        // one counting pass, stable, so repeated writes to a key keep their order; a
+        // resize meanwhile only costs sharing
+        const size_t cap = observed_capacity();
+        unsigned shift = 0;
+        while (((cap - 1) >> shift) >= APPLY_RADIX) shift++;
+        auto part = [&](size_t h1) {
+            const size_t i1 = Storage::reduce(h1, cap);
+            if constexpr (LockPolicy::stripe_count > 1) {
+                return lock_id(0, i1) % LockPolicy::stripe_count;
+            } else {
+                return i1 >> shift;
+            }
+        };
+        std::vector<HashedUpdate> hashed(n), work(n);
+        size_t start[APPLY_PARTS + 1] = {};
+        for (size_t i = 0; i < n; i++) {
+            hashed[i] = HashedUpdate{Hashers::h1(updates[i].key), Hashers::h2(updates[i].key), updates[i]};
+            start[part(hashed[i].h1) + 1]++;
+        }
+        for (size_t p = 0; p < APPLY_PARTS; p++) start[p + 1] += start[p];
+        for (size_t i = 0; i < n; i++) work[start[part(hashed[i].h1)]++] = hashed[i];
+        for (size_t i = 0; i < n; i += GROUP) {
+            apply_group(work.data() + i, std::min(GROUP, n - i), result);
+        }
+        return result;
+    }
+
+    // adds every key of other. new keys are found by probing this table from parallel
+    // chunks of other's buckets, then placed into disjoint bucket ranges in parallel
+    void merge_from(const CuckooTable& other, size_t workers = default_workers()) {
+        if (this == &other) return;
+        workers = std::max<size_t>(1, workers);
+        lock_with(other, [&] {
+            reserve_unlocked(count.load() + other.count.load());
+            Bins fresh = collect_from(other, false, workers);
+            bulk_insert(fresh, workers);
+        });
+    }
+
+    // keeps only keys also in other. a smaller other is scanned for the survivors and this
+    // table is refilled in place; otherwise this table's bucket chunks are filtered in parallel
+    void intersect_with(const CuckooTable& other, size_t workers = default_workers()) {
+        if (this == &other) return;
+        workers = std::max<size_t>(1, workers);
+        lock_with(other, [&] {
+            if (other.count.load() < count.load()) {
+                Bins keep = collect_from(other, true, workers);
+                parallel_chunks(capacity, workers, [&](size_t b0, size_t b1, size_t) {
+                    for (size_t b = b0; b < b1; b++) table1[b].used = table2[b].used = 0;
+                });
+                dirty.mark_all();
+                count.store(0);
+                bulk_insert(keep, workers);
+                return;
+            }
+            std::vector<size_t> removed(workers, 0);
+            parallel_chunks(capacity, workers, [&](size_t b0, size_t b1, size_t w) {
+                scan_against(other, b0, b1, [&](const SlotRef& ref, const Key&, bool found) {
+                    if (found) return;
+                    clear_slot(ref);
+                    removed[w]++;
+                });
+            });
+            size_t total = 0;
+            for (size_t r : removed) total += r;
+            if (total) dirty.mark_all();
+            count.store(count.load() - total);
+        });
+    }
+
+    // removes every key of other, iterating whichever table is smaller
+    void subtract(const CuckooTable& other, size_t workers = default_workers()) {
+        if (this == &other) {
+            clear();
+            return;
+        }
+        workers = std::max<size_t>(1, workers);
+        lock_with(other, [&] {
+            std::vector<size_t> removed(workers, 0);
+            if (other.count.load() < count.load()) {
+                // find the victims from other's side, then clear them in one pass
+                std::vector<std::vector<SlotRef>> hits(workers);
+                other.parallel_chunks(other.capacity, workers, [&](size_t b0, size_t b1, size_t w) {
+                    other.scan_against(*this, b0, b1, [&](const SlotRef&, const Key& key, bool found) {
+                        if (found) hits[w].push_back(locate_unlocked(key));
+                    });
+                });
+                for (size_t w = 0; w < workers; w++) {
+                    for (const SlotRef& ref : hits[w]) {
+                        clear_slot(ref);
+                        touched(ref.t, ref.b);
+                    }
+                    removed[w] = hits[w].size();
+                }
+            } else {
+                parallel_chunks(capacity, workers, [&](size_t b0, size_t b1, size_t w) {
+                    scan_against(other, b0, b1, [&](const SlotRef& ref, const Key&, bool found) {
+                        if (!found) return;
+                        clear_slot(ref);
+                        removed[w]++;
+                    });
+                });
+                dirty.mark_all();
+            }
+            size_t total = 0;
+            for (size_t r : removed) total += r;
+            count.store(count.load() - total);
+        });
+    }
+
+    // non-mutating forms: copy the larger (or only relevant) table's buckets wholesale,
+    // then apply the in-place operation
+    CuckooTable merged(const CuckooTable& other, size_t workers = default_workers()) const {
+        const bool mine = size() >= other.size();
+        CuckooTable result(CloneTag{}, mine ? *this : other);
+        result.merge_from(mine ? other : *this, workers);
+        return result;
+    }
+
+    CuckooTable intersected(const CuckooTable& other, size_t workers = default_workers()) const {
+        const bool mine = size() <= other.size();
+        CuckooTable result(CloneTag{}, mine ? *this : other);
+        result.intersect_with(mine ? other : *this, workers);
+        return result;
+    }
+
+    CuckooTable subtracted(const CuckooTable& other, size_t workers = default_workers()) const {
+        CuckooTable result(CloneTag{}, *this);
+        result.subtract(other, workers);
+        return result;
+    }
+
+    // immutable, lock-free copy of the current keys; include cuckoo_frozen.h to use
+    FrozenCuckooSet<Key, Hashers> freeze(FrozenIndex index = FrozenIndex::bucketed) const {
+        std::vector<Key> keys;
+        keys.reserve(size());
+        for_each([&](const Key& key) { keys.push_back(key); });
+        return FrozenCuckooSet<Key, Hashers>(std::move(keys), index);
+    }
+
+    // bytes of one bucket, for regions that lay the buckets out themselves
+    static constexpr size_t bucket_bytes = sizeof(Bucket);
+
+    // bucket layout a checkpoint log records, see cuckoo_checkpoint.h
+    static constexpr uint32_t tracking_bucket_bytes = sizeof(Bucket);
+    static constexpr uint32_t tracking_group_buckets = Tracking::group_buckets;
+
+    // copies every bucket group written since the last call (all of them if full) and
+    // clears the marks. runs under exclusive_all, so the delta is a consistent cut and the
+    // pause grows with the number of dirty groups rather than with the table
+    CheckpointDelta take_delta(bool full = false) {
+        static_assert(Tracking::enabled, "take_delta needs a DirtyGroups tracking policy");
+        static_assert(std::is_trivially_copyable_v<Key>, "checkpoints copy buckets as raw bytes");
+        CheckpointDelta delta;
+        delta.bucket_bytes = sizeof(Bucket);
+        locks.exclusive_all([&] {
+            if (full) dirty.mark_all();
+            delta.capacity = capacity;
+            delta.count = count.load();
+            delta.full = dirty.drain(capacity, [&](int t, size_t first, size_t n) {
+                const Bucket* src = (t ? table2 : table1).data() + first;
+                const auto* raw = reinterpret_cast<const unsigned char*>(src);
+                delta.groups.push_back({static_cast<uint32_t>(t), static_cast<uint32_t>(n), first});
+                delta.bytes.insert(delta.bytes.end(), raw, raw + n * sizeof(Bucket));
+            });
+        });
+        return delta;
+    }
+
+    // writes a delta read back from a checkpoint; a full delta first resets the table to
+    // its capacity. the table comes out clean, the delta is what is already on disk
+    void apply_delta(const CheckpointDelta& delta) {
+        static_assert(Tracking::enabled, "apply_delta needs a DirtyGroups tracking policy");
+        static_assert(std::is_trivially_copyable_v<Key>, "checkpoints copy buckets as raw bytes");
+        if (delta.bucket_bytes != sizeof(Bucket) || Storage::round(delta.capacity) != delta.capacity) {
+            throw std::runtime_error("CuckooTable: checkpoint does not match this table type");
+        }
+        size_t total = 0;
+        for (const auto& g : delta.groups) {
+            if (g.table > 1 || g.first + g.buckets > delta.capacity) {
+                throw std::runtime_error("CuckooTable: checkpoint group out of range");
+            }
+            total += g.buckets * sizeof(Bucket);
+        }
+        if (total != delta.bytes.size()) {
+            throw std::runtime_error("CuckooTable: checkpoint group sizes do not add up");
+        }
+        if (!delta.full && observed_capacity() != delta.capacity) {
+            throw std::runtime_error("CuckooTable: delta taken at a different capacity");
+        }
+        locks.exclusive_all([&] {
+            if (delta.full) {
+                table1.assign(delta.capacity, Bucket());
+                table2.assign(delta.capacity, Bucket());
+                set_capacity(delta.capacity);
+            }
+            size_t offset = 0;
+            for (const auto& g : delta.groups) {
+                const size_t n = g.buckets;
+                Bucket* dst = (g.table ? table2 : table1).data() + g.first;
+                std::memcpy(static_cast<void*>(dst), delta.bytes.data() + offset, n * sizeof(Bucket));
+                offset += n * sizeof(Bucket);
+            }
+            count.store(delta.count);
+            dirty.reset(capacity, false);
+        });
+    }
+
+    size_t bucket_count() const {
+        return observed_capacity();
+    }
+
+    // every slot of both tables; an evicting table never holds more keys
+    size_t slot_count() const {
+        return 2 * observed_capacity() * SlotsPerBucket;
+    }
+
+    // keys that lost their slot to a new key, for tables with an eviction policy
+    size_t evictions() const {
+        return eviction.evictions();
+    }
+
+    void populate(size_t n, int min = 0, int max = 1000) {
+        std::random_device rd;
+        std::mt19937 gen(rd());
+        std::uniform_int_distribution<> dist(min, max);
+        for (size_t i = 0; i < n; i++) {
+            add(static_cast<Key>(dist(gen)));
+        }
+    }
+};
+
+// ---------------------------------------------------------------------------
+// read-only set whose tables are laid out at compile time
+// ---------------------------------------------------------------------------
+
+template<typename Key, size_t Buckets, size_t SlotsPerBucket = 4, typename Hashers = MixHashers<Key>>
+class ConstCuckooSet {
+    static_assert(Buckets > 0 && SlotsPerBucket >= 1 && SlotsPerBucket <= 32, "bad geometry");
+    using Mask = slot_mask_t<SlotsPerBucket>;
+
+public:
+    template<size_t N>
+    constexpr explicit ConstCuckooSet(const Key (&keys)[N]) {
+        for (size_t i = 0; i < N; i++) insert(keys[i]);
+    }
+
+    template<size_t N>
+    constexpr explicit ConstCuckooSet(const std::array<Key, N>& keys) {
+        for (size_t i = 0; i < N; i++) insert(keys[i]);
+    }
+
+    constexpr bool contains(const Key& key) const {
+        return find(0, index(0, key), key) || find(1, index(1, key), key);
+    }
+
+    constexpr size_t size() const { return count; }
+
+private:
+    Key keys[2][Buckets][SlotsPerBucket] = {};
+    Mask used[2][Buckets] = {};
+    size_t count = 0;
+
+    static constexpr size_t index(int t, const Key& key) {
+        const size_t h = t ? Hashers::h2(key) : Hashers::h1(key);
+        if constexpr (is_pow2(Buckets)) {
+            return h & (Buckets - 1);
+        } else {
+            return h % Buckets;
+        }
+    }
+
+    constexpr bool find(int t, size_t b, const Key& key) const {
+        for (size_t s = 0; s < SlotsPerBucket; s++) {
+            if (((used[t][b] >> s) & 1) && keys[t][b][s] == key) return true;
+        }
+        return false;
+    }
+
+    constexpr bool place(int t, size_t b, const Key& key) {
+        for (size_t s = 0; s < SlotsPerBucket; s++) {
+            if (!((used[t][b] >> s) & 1)) {
+                keys[t][b][s] = key;
+                used[t][b] = static_cast<Mask>(used[t][b] | (1u << s));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // classic kick-out walk alternating between the tables; failing here fails the build
+    constexpr void insert(Key key) {
+        if (contains(key)) return;
+        if (place(0, index(0, key), key) || place(1, index(1, key), key)) {
+            count++;
+            return;
+        }
+        int t = 0;
+        for (size_t attempt = 0; attempt < MAX_MIGRATIONS * SlotsPerBucket; attempt++) {
+            const size_t b = index(t, key);
+            if (place(t, b, key)) {
+                count++;
+                return;
+            }
+            const size_t s = attempt % SlotsPerBucket;
+            Key displaced = keys[t][b][s];
+            keys[t][b][s] = key;
+            key = displaced;
+            t = 1 - t;
+        }
+        throw std::length_error("ConstCuckooSet: keys do not fit, raise Buckets");
+    }
+};
@@ -0,0 +1,640 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ---------------------------------------------------------------------------
+// workload traces: a header, then chunks of one recording thread's records each. a chunk
+// is a ChunkHeader followed by fixed-width records of
+//   op (1 byte) [thread id (2 bytes)] [ns since the recording started (8 bytes)] key (4 or 8 bytes)
+// in host byte order. the header says which optional fields are present and how wide
+// keys are, so a lookup-only trace of int keys costs 5 bytes per op. fixed widths let a
+// reader map the file and hand each thread its chunks without decoding anything first
+// ---------------------------------------------------------------------------
+
+namespace trace {
+
+enum Op : uint8_t { CONTAINS = 0, ADD = 1, REMOVE = 2 };
+
+enum Flags : uint8_t {
+    HAS_THREAD = 1,
+    HAS_TIME = 2,
+};
+
+struct FileHeader {
+    char magic[8];      // "CKTRACE1"
+    uint16_t version;
+    uint8_t flags;
+    uint8_t key_bytes;  // 4 or 8
+    uint32_t reserved;
+    uint64_t start_ns;  // wall clock at the start of the recording, informational
+};
+
+constexpr char MAGIC[8] = {'C', 'K', 'T', 'R', 'A', 'C', 'E', '1'};
+constexpr uint16_t VERSION = 2;
+
+// one drained writer buffer; records of a chunk are in recorded order
+struct ChunkHeader {
+    uint32_t records;
+    uint16_t thread;   // recording thread, present with or without HAS_THREAD
+    uint16_t reserved;
+};
+
+struct Record {
+    Op op;
+    uint16_t thread; // 0 without HAS_THREAD
+    uint64_t time;   // 0 without HAS_TIME
+    int64_t key;
+};
+
+inline size_t record_bytes(uint8_t flags, uint8_t key_bytes) {
+    return 1 + ((flags & HAS_THREAD) ? 2 : 0) + ((flags & HAS_TIME) ? 8 : 0) + key_bytes;
+}
+
+[[noreturn]] inline void fail(const char* what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+inline void write_all(int fd, const void* data, size_t n) {
+    const auto* p = static_cast<const unsigned char*>(data);
+    while (n) {
+        const ssize_t w = ::write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            fail("trace: write");
+        }
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+}
+
+} // namespace trace
+
+// appends records to a trace file. every recording thread fills its own buffer and
+// writes it out as one chunk when it is full, so threads only meet on the file once per
+// BUFFER_BYTES. the file is therefore in order per thread, and chunks of different
+// threads interleave; each chunk header names its thread, so a reader can follow one
+// thread's records without scanning the others. thread ids are
+// small integers handed out on each thread's first record, times come from steady_clock
+class TraceWriter {
+public:
+    TraceWriter(const std::string& path, uint8_t flags = trace::HAS_THREAD | trace::HAS_TIME,
+                uint8_t key_bytes = 8)
+        : flags(flags), key_bytes(key_bytes), width(trace::record_bytes(flags, key_bytes)),
+          start(std::chrono::steady_clock::now()), serial(next_serial()) {
+        if (key_bytes != 4 && key_bytes != 8) throw std::invalid_argument("TraceWriter: keys are 4 or 8 bytes");
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) trace::fail("TraceWriter: open");
+        trace::FileHeader h{};
+        std::memcpy(h.magic, trace::MAGIC, sizeof(h.magic));
+        h.version = trace::VERSION;
+        h.flags = flags;
+        h.key_bytes = key_bytes;
+        h.start_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        trace::write_all(fd, &h, sizeof(h));
+    }
+
+    ~TraceWriter() {
+        flush();
+        ::close(fd);
+    }
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    void append(trace::Op op, int64_t key) {
+        Local& local = this_thread();
+        unsigned char rec[1 + 2 + 8 + 8];
+        size_t n = 0;
+        rec[n++] = op;
+        if (flags & trace::HAS_THREAD) {
+            std::memcpy(rec + n, &local.id, 2);
+            n += 2;
+        }
+        if (flags & trace::HAS_TIME) {
+            const uint64_t t = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+            std::memcpy(rec + n, &t, 8);
+            n += 8;
+        }
+        if (key_bytes == 4) {
+            const int32_t k = static_cast<int32_t>(key);
+            std::memcpy(rec + n, &k, 4);
+        } else {
+            std::memcpy(rec + n, &key, 8);
+        }
+        // only flush() ever takes this lock from another thread
+        std::lock_guard<std::mutex> guard(local.m);
+        local.buffer.insert(local.buffer.end(), rec, rec + width);
+        local.written++;
+        if (local.buffer.size() + width > BUFFER_BYTES) drain(local);
+    }
+
+    // writes every thread's buffered records; safe while threads are still recording
+    void flush() {
+        for (Local* local : snapshot()) {
+            std::lock_guard<std::mutex> guard(local->m);
+            drain(*local);
+        }
+    }
+
+    size_t records() const {
+        size_t n = 0;
+        for (Local* local : snapshot()) {
+            std::lock_guard<std::mutex> guard(local->m);
+            n += local->written;
+        }
+        return n;
+    }
+
+private:
+    static constexpr size_t BUFFER_BYTES = 64 << 10; // per recording thread
+
+    struct Local {
+        std::mutex m;
+        std::vector<unsigned char> buffer;
+        size_t written = 0;
+        uint16_t id = 0;
+    };
+
+    const uint8_t flags;
+    const uint8_t key_bytes;
+    const size_t width;
+    const std::chrono::steady_clock::time_point start;
+    const uint64_t serial; // tells writers apart even when one reuses another's address
+    int fd = -1;
+    std::mutex file_lock;               // taken inside a Local's lock, never around one
+    mutable std::mutex registry_lock;
+    std::vector<std::unique_ptr<Local>> locals;
+
+    static uint64_t next_serial() {
+        static std::atomic<uint64_t> serials{0};
+        return serials.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // the calling thread's buffer, registered on its first record; ids are per writer
+    Local& this_thread() {
+        thread_local std::vector<std::pair<uint64_t, Local*>> mine;
+        for (const auto& [s, local] : mine) {
+            if (s == serial) return *local;
+        }
+        std::lock_guard<std::mutex> guard(registry_lock);
+        locals.push_back(std::make_unique<Local>());
+        Local* local = locals.back().get();
+        local->id = static_cast<uint16_t>(locals.size() - 1);
+        local->buffer.reserve(BUFFER_BYTES);
+        local->buffer.resize(sizeof(trace::ChunkHeader)); // filled in by drain()
+        mine.emplace_back(serial, local);
+        return *local;
+    }
+
+    std::vector<Local*> snapshot() const {
+        std::lock_guard<std::mutex> guard(registry_lock);
+        std::vector<Local*> all;
+        for (const auto& local : locals) all.push_back(local.get());
+        return all;
+    }
+
+    // caller holds local.m
+    void drain(Local& local) {
+        const size_t records = (local.buffer.size() - sizeof(trace::ChunkHeader)) / width;
+        if (records == 0) return;
+        const trace::ChunkHeader h{static_cast<uint32_t>(records), local.id, 0};
+        std::memcpy(local.buffer.data(), &h, sizeof(h));
+        std::lock_guard<std::mutex> guard(file_lock);
+        trace::write_all(fd, local.buffer.data(), local.buffer.size());
+        local.buffer.resize(sizeof(trace::ChunkHeader));
+    }
+};
+
+// recorder hook: wraps any engine and appends every add/remove/contains to a trace,
+// then forwards it. everything else is reached through engine()
+template<typename Set>
+class Recorded {
+public:
+    using key_type = typename Set::key_type;
+
+    Recorded(Set& set, TraceWriter& writer) : set(set), writer(writer) {}
+
+    bool add(const key_type& key) {
+        writer.append(trace::ADD, static_cast<int64_t>(key));
+        return set.add(key);
+    }
+
+    bool remove(const key_type& key) {
+        writer.append(trace::REMOVE, static_cast<int64_t>(key));
+        return set.remove(key);
+    }
+
+    // const like every engine's contains(): the lookup leaves the set alone, and the
+    // writer it logs to is not part of the set
+    bool contains(const key_type& key) const {
+        writer.append(trace::CONTAINS, static_cast<int64_t>(key));
+        return set.contains(key);
+    }
+
+    size_t size() const { return set.size(); }
+    Set& engine() { return set; }
+
+private:
+    Set& set;
+    TraceWriter& writer;
+};
+
+// read-only mapping of a trace. opening walks the chunk headers into a directory of one
+// entry per chunk; records are decoded on access, so replay threads stream through their
+// chunks without a decoded copy of the file. a torn last record is ignored
+class TraceReader {
+public:
+    struct Chunk {
+        const unsigned char* data; // first record
+        size_t first;              // file-wide index of the first record
+        uint32_t records;
+        uint16_t thread;
+    };
+
+    explicit TraceReader(const std::string& path) {
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) trace::fail("TraceReader: open");
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            const int err = errno;
+            ::close(fd);
+            errno = err;
+            trace::fail("TraceReader: fstat");
+        }
+        bytes = static_cast<size_t>(st.st_size);
+        if (bytes < sizeof(trace::FileHeader)) {
+            ::close(fd);
+            throw std::runtime_error("TraceReader: not a trace");
+        }
+        void* p = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            const int err = errno;
+            ::close(fd);
+            errno = err;
+            trace::fail("TraceReader: mmap");
+        }
+        base = static_cast<const unsigned char*>(p);
+        madvise(p, bytes, MADV_SEQUENTIAL);
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, trace::MAGIC, sizeof(header.magic)) != 0 || header.version != trace::VERSION ||
+            (header.key_bytes != 4 && header.key_bytes != 8)) {
+            munmap(p, bytes);
+            ::close(fd);
+            throw std::runtime_error("TraceReader: not a trace");
+        }
+        width = trace::record_bytes(header.flags, header.key_bytes);
+        for (size_t at = sizeof(header); bytes - at > sizeof(trace::ChunkHeader);) {
+            trace::ChunkHeader h;
+            std::memcpy(&h, base + at, sizeof(h));
+            at += sizeof(h);
+            const size_t records = std::min<size_t>(h.records, (bytes - at) / width);
+            if (records == 0) break;
+            dir.push_back(Chunk{base + at, count, static_cast<uint32_t>(records), h.thread});
+            count += records;
+            at += records * width;
+        }
+    }
+
+    ~TraceReader() {
+        munmap(const_cast<unsigned char*>(base), bytes);
+        ::close(fd);
+    }
+
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    size_t size() const { return count; }
+    size_t record_bytes() const { return width; }
+    uint8_t flags() const { return header.flags; }
+    bool has_threads() const { return header.flags & trace::HAS_THREAD; }
+    bool has_times() const { return header.flags & trace::HAS_TIME; }
+
+    // every chunk in file order
+    const std::vector<Chunk>& chunks() const { return dir; }
+
+    // record j of chunk c
+    trace::Record record(const Chunk& c, size_t j) const {
+        const unsigned char* p = c.data + j * width;
+        trace::Record r{static_cast<trace::Op>(*p++), 0, 0, 0};
+        if (header.flags & trace::HAS_THREAD) {
+            std::memcpy(&r.thread, p, 2);
+            p += 2;
+        }
+        if (header.flags & trace::HAS_TIME) {
+            std::memcpy(&r.time, p, 8);
+            p += 8;
+        }
+        if (header.key_bytes == 4) {
+            int32_t k;
+            std::memcpy(&k, p, 4);
+            r.key = k;
+        } else {
+            std::memcpy(&r.key, p, 8);
+        }
+        return r;
+    }
+
+    // record i in file order
+    trace::Record operator[](size_t i) const {
+        auto c = std::upper_bound(dir.begin(), dir.end(), i, [](size_t x, const Chunk& c) { return x < c.first; });
+        --c;
+        return record(*c, i - c->first);
+    }
+
+private:
+    int fd = -1;
+    const unsigned char* base = nullptr;
+    size_t bytes = 0;
+    trace::FileHeader header{};
+    size_t width = 0;
+    size_t count = 0;
+    std::vector<Chunk> dir;
+};
+
+// how replay() hands records to threads and when it issues them
+enum class ReplaySplit {
+    automatic,  // by recorded thread when the trace has ids, else contiguous
+    contiguous, // thread t takes the t-th equal slice of the records in order
+    by_thread,  // thread t takes every record whose recorded id % threads == t, in order
+};
+
+enum class ReplayPace {
+    full,     // back to back
+    recorded, // each op no earlier than its recorded offset from the first record
+};
+
+struct ReplayStats {
+    size_t ops = 0;
+    size_t hits = 0;       // contains() that found its key
+    double max_lag = 0.0;  // paced replay: furthest behind schedule, microseconds
+};
+
+// which records each replay thread issues. the plan groups the chunk directory into one
+// stream per recording thread and gives each replay thread a range of some of the
+// streams, a few words per chunk; while it replays, a thread merges its ranges lazily,
+// reading records straight from the mapping. with timestamps, "in order" is recorded
+// time order, otherwise file order. build it outside the timed region and reuse it
+class ReplayPlan {
+public:
+    ReplayPlan(const TraceReader& trace, size_t threads, ReplaySplit split = ReplaySplit::automatic)
+        : workers(std::max<size_t>(1, threads)), timed(trace.has_times()), parts(workers) {
+        if (split == ReplaySplit::automatic) {
+            split = trace.has_threads() ? ReplaySplit::by_thread : ReplaySplit::contiguous;
+        }
+        if (split == ReplaySplit::by_thread && !trace.has_threads()) {
+            throw std::invalid_argument("replay: trace has no thread ids");
+        }
+        const auto& chunks = trace.chunks();
+        std::vector<size_t> of_thread; // recorded id -> stream index + 1
+        for (size_t c = 0; c < chunks.size(); c++) {
+            const uint16_t id = chunks[c].thread;
+            if (id >= of_thread.size()) of_thread.resize(id + 1, 0);
+            if (of_thread[id] == 0) {
+                streams.push_back(Stream{id, {}, {}});
+                of_thread[id] = streams.size();
+            }
+            Stream& s = streams[of_thread[id] - 1];
+            s.chunks.push_back(c);
+            s.ends.push_back(length(s) + chunks[c].records);
+        }
+        if (timed && !streams.empty()) {
+            first = UINT64_MAX;
+            for (size_t s = 0; s < streams.size(); s++) first = std::min(first, key(trace, s, 0));
+        }
+        if (split == ReplaySplit::by_thread) {
+            for (size_t s = 0; s < streams.size(); s++) {
+                parts[streams[s].thread % workers].push_back(Part{s, 0, length(streams[s])});
+            }
+            return;
+        }
+        std::vector<size_t> from(streams.size(), 0);
+        for (size_t t = 0; t < workers; t++) {
+            std::vector<size_t> to = split_at(trace, (t + 1) * trace.size() / workers);
+            for (size_t s = 0; s < streams.size(); s++) {
+                if (from[s] < to[s]) parts[t].push_back(Part{s, from[s], to[s]});
+            }
+            from = std::move(to);
+        }
+    }
+
+    size_t threads() const { return workers; }
+
+    // earliest recorded time, which paced replay schedules from; 0 without HAS_TIME
+    uint64_t first_time() const { return first; }
+
+    // f(record) for every record of replay thread t, in trace order
+    template<typename F>
+    void for_each(const TraceReader& trace, size_t t, F&& f) const {
+        const auto& chunks = trace.chunks();
+        struct Cursor {
+            const Stream* stream;
+            size_t pos, end; // positions in the stream
+            size_t c, o;     // chunk of the stream and record within it at pos
+            trace::Record r;
+            uint64_t key;
+        };
+        auto load = [&](Cursor& x) {
+            const TraceReader::Chunk& chunk = chunks[x.stream->chunks[x.c]];
+            x.r = trace.record(chunk, x.o);
+            x.key = timed ? x.r.time : chunk.first + x.o;
+        };
+        std::vector<Cursor> cursors;
+        for (const Part& p : parts[t]) {
+            const Stream& s = streams[p.stream];
+            const size_t c = chunk_of(s, p.begin);
+            Cursor x{&s, p.begin, p.end, c, p.begin - (c ? s.ends[c - 1] : 0), {}, 0};
+            load(x);
+            cursors.push_back(x);
+        }
+        // min-heap of cursors by key; parts are in stream order, as split_at() breaks ties
+        auto later = [&](size_t a, size_t b) {
+            return cursors[a].key != cursors[b].key ? cursors[a].key > cursors[b].key : a > b;
+        };
+        std::vector<size_t> heap;
+        for (size_t i = 0; i < cursors.size(); i++) heap.push_back(i);
+        std::make_heap(heap.begin(), heap.end(), later);
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            Cursor& x = cursors[heap.back()];
+            f(x.r);
+            if (++x.pos == x.end) {
+                heap.pop_back();
+                continue;
+            }
+            if (++x.o == chunks[x.stream->chunks[x.c]].records) {
+                x.c++;
+                x.o = 0;
+            }
+            load(x);
+            std::push_heap(heap.begin(), heap.end(), later);
+        }
+    }
+
+private:
+    // one recording thread's chunks in file order; ends[i] counts its records through chunk i
+    struct Stream {
+        uint16_t thread;
+        std::vector<size_t> chunks;
+        std::vector<size_t> ends;
+    };
+
+    // positions [begin, end) of a stream
+    struct Part {
+        size_t stream;
+        size_t begin, end;
+    };
+
+    size_t workers;
+    bool timed;
+    uint64_t first = 0;
+    std::vector<Stream> streams;
+    std::vector<std::vector<Part>> parts; // per replay thread
+
+    static size_t length(const Stream& s) { return s.ends.empty() ? 0 : s.ends.back(); }
+
+    static size_t chunk_of(const Stream& s, size_t pos) {
+        return static_cast<size_t>(std::upper_bound(s.ends.begin(), s.ends.end(), pos) - s.ends.begin());
+    }
+
+    // merge order of a record: its time, or its place in the file without times; keys
+    // never decrease along a stream
+    uint64_t key(const TraceReader& trace, size_t s, size_t pos) const {
+        const Stream& stream = streams[s];
+        const size_t c = chunk_of(stream, pos);
+        const TraceReader::Chunk& chunk = trace.chunks()[stream.chunks[c]];
+        const size_t o = pos - (c ? stream.ends[c - 1] : 0);
+        return timed ? trace.record(chunk, o).time : chunk.first + o;
+    }
+
+    // first position in stream s whose key is above k, or when !above not below k
+    size_t bound(const TraceReader& trace, size_t s, uint64_t k, bool above) const {
+        size_t lo = 0, hi = length(streams[s]);
+        while (lo < hi) {
+            const size_t mid = lo + (hi - lo) / 2;
+            const uint64_t m = key(trace, s, mid);
+            if (m < k || (above && m == k)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    // a position per stream such that exactly r records come before them in merge order,
+    // by (key, stream): binary search for the key of record r, then take the records
+    // with that key stream by stream
+    std::vector<size_t> split_at(const TraceReader& trace, size_t r) const {
+        std::vector<size_t> at(streams.size());
+        uint64_t lo = 0, hi = 0;
+        for (size_t s = 0; s < streams.size(); s++) {
+            at[s] = length(streams[s]);
+            if (at[s]) hi = std::max(hi, key(trace, s, at[s] - 1));
+        }
+        if (r >= trace.size()) return at;
+        while (lo < hi) {
+            const uint64_t mid = lo + (hi - lo) / 2;
+            size_t upto = 0;
+            for (size_t s = 0; s < streams.size(); s++) upto += bound(trace, s, mid, true);
+            if (upto > r) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        size_t below = 0;
+        for (size_t s = 0; s < streams.size(); s++) {
+            at[s] = bound(trace, s, lo, false);
+            below += at[s];
+        }
+        for (size_t s = 0; s < streams.size() && below < r; s++) {
+            const size_t take = std::min(r - below, bound(trace, s, lo, true) - at[s]);
+            at[s] += take;
+            below += take;
+        }
+        return at;
+    }
+};
+
+// replays trace against set with one thread per plan thread
+template<typename Set>
+ReplayStats replay(Set& set, const TraceReader& trace, const ReplayPlan& plan, ReplayPace pace = ReplayPace::full) {
+    using Key = typename Set::key_type;
+    using Clock = std::chrono::steady_clock;
+    if (pace == ReplayPace::recorded && !trace.has_times()) {
+        throw std::invalid_argument("replay: trace has no timestamps");
+    }
+
+    const size_t threads = plan.threads();
+    const uint64_t first = plan.first_time();
+    std::vector<ReplayStats> stats(threads);
+    std::vector<std::thread> workers;
+    const Clock::time_point start = Clock::now();
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            ReplayStats& s = stats[t];
+            plan.for_each(trace, t, [&](const trace::Record& r) {
+                if (pace == ReplayPace::recorded) {
+                    // offsets are from the earliest record of the whole trace, so threads keep their spacing
+                    const auto offset = static_cast<int64_t>(r.time - first);
+                    const Clock::time_point due = start + std::chrono::nanoseconds(offset);
+                    Clock::time_point now = Clock::now();
+                    if (due - now > std::chrono::microseconds(100)) {
+                        std::this_thread::sleep_until(due - std::chrono::microseconds(50));
+                        now = Clock::now();
+                    }
+                    while (now < due) {
+                        std::this_thread::yield();
+                        now = Clock::now();
+                    }
+                    s.max_lag = std::max(s.max_lag, std::chrono::duration<double, std::micro>(now - due).count());
+                }
+                const Key key = static_cast<Key>(r.key);
+                switch (r.op) {
+                case trace::CONTAINS: s.hits += set.contains(key); break;
+                case trace::ADD: set.add(key); break;
+                case trace::REMOVE: set.remove(key); break;
+                }
+                s.ops++;
+            });
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    ReplayStats total;
+    for (const auto& s : stats) {
+        total.ops += s.ops;
+        total.hits += s.hits;
+        total.max_lag = std::max(total.max_lag, s.max_lag);
+    }
+    return total;
+}
+
+// replay() with a plan built on the spot
+template<typename Set>
+ReplayStats replay(Set& set, const TraceReader& trace, size_t threads, ReplayPace pace = ReplayPace::full,
+                   ReplaySplit split = ReplaySplit::automatic) {
+    return replay(set, trace, ReplayPlan(trace, threads, split), pace);
+}
@@ -1,139 +1,12 @@
 #include <iostream>
-#include <vector>
 #include <random>
 #include <chrono>
-#include <functional>
 
-constexpr size_t MAX_MIGRATIONS = 32;
+#include "cuckoo_table.h"
+#include "perf_counters.h"
 
-size_t h1(int key, size_t capacity) {
-    return std::hash<int>{}(key) % capacity;
-}
-
-size_t h2(int key, size_t capacity) {
-    return (std::hash<int>{}(~key)) % capacity;
-}
-
-struct Bucket {
-    int key;
-    bool valid;
-    Bucket() : key(0), valid(false) {}
-};
-
-class CuckooHash {
-private:
-    std::vector<Bucket> table1;
-    std::vector<Bucket> table2;
-    size_t count;
-    size_t capacity;
-
-    void resize() {
-        std::vector<Bucket> old1 = table1;
-        std::vector<Bucket> old2 = table2;
-
-        capacity *= 2;
-        table1.clear(); table1.resize(capacity);
-        table2.clear(); table2.resize(capacity);
-        count = 0;
-
-        for (const auto& b : old1) {
-            if (b.valid) add(b.key);
-        }
-        for (const auto& b : old2) {
-            if (b.valid) add(b.key);
-        }
-    }
-
-public:
-    CuckooHash(size_t num_buckets) : table1(num_buckets), table2(num_buckets), count(0), capacity(num_buckets) {}
-
-    bool add(int key) {
-        size_t i1 = h1(key, capacity);
-        size_t i2 = h2(key, capacity);
-    
-        if ((table1[i1].valid && table1[i1].key == key) ||
-            (table2[i2].valid && table2[i2].key == key)) {
-            return false;
-        }
-    
-        bool result = false;
-        for (size_t attempt = 0; attempt < MAX_MIGRATIONS; ++attempt) {
-            i1 = h1(key, capacity);
-            i2 = h2(key, capacity);
-    
-            __transaction_atomic {
-                if (!table1[i1].valid) {
-                    table1[i1].key = key;
-                    table1[i1].valid = true;
-                    count++;
-                    result = true;
-                    return result;
-                }
-                if (!table2[i2].valid) {
-                    table2[i2].key = key;
-                    table2[i2].valid = true;
-                    count++;
-                    result = true;
-                    return result;
-                }
-    
-                std::swap(key, table1[i1].key);
-            }
-        }
-    
-        resize();
-        return add(key);
-    }
-
-    bool remove(int key) {
-        size_t i1 = h1(key, capacity);
-        size_t i2 = h2(key, capacity);
-    
-        if (!(table1[i1].valid && table1[i1].key == key) &&
-            !(table2[i2].valid && table2[i2].key == key)) {
-            return false;
-        }
-    
-        bool result = false;
-        __transaction_atomic {
-            if (table1[i1].valid && table1[i1].key == key) {
-                table1[i1].valid = false;
-                count--;
-                result = true;
-            } else if (table2[i2].valid && table2[i2].key == key) {
-                table2[i2].valid = false;
-                count--;
-                result = true;
-            }
-        }
-    
-        return result;
-    }
-
-    bool contains(int key) const {
-        size_t i1 = h1(key, capacity);
-        size_t i2 = h2(key, capacity);
-        return (table1[i1].valid && table1[i1].key == key) ||
-               (table2[i2].valid && table2[i2].key == key);
-    }
-
-    size_t size() const {
-        size_t result;
-        __transaction_atomic {
-            result = count;
-        }
-        return result;
-    }
-
-    void populate(size_t n, int min = 0, int max = 1000) {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<> dist(min, max);
-        for (size_t i = 0; i < n; ++i) {
-            add(static_cast<int>(dist(gen)));
-        }
-    }
-};
+// v2 layout with every bucket section run as a GNU TM transaction
+using CuckooHash = CuckooTable<int, 4, MixHashers<int>, TransactionalLock, Pow2Storage>;
 
 int main() {
     const size_t num_buckets = 1000;
@@ -142,8 +15,9 @@ int main() {
     const int num_iter = 50;
     double total_time = 0.0;
 
+    PerfCounters perf;
     for (int i = 0; i < num_iter; i++) {
-        CuckooHash hashset(num_buckets);
+        CuckooHash hashset(num_buckets / CuckooHash::slots_per_bucket);
         hashset.populate(100);
         size_t expected_size = hashset.size();
 
@@ -152,6 +26,7 @@ int main() {
         std::uniform_int_distribution<> opDist(1, 100);
         std::uniform_int_distribution<> keyDist(0, 1000);
 
+        perf.start();
         auto start = std::chrono::high_resolution_clock::now();
         for (size_t i = 0; i < num_ops; i++) {
             int op = opDist(gen);
@@ -167,12 +42,14 @@ int main() {
             }
         }
         auto end = std::chrono::high_resolution_clock::now();
+        perf.stop();
         std::chrono::duration<double, std::micro> duration = end - start;
         total_time += duration.count();
     }
 
     double avg_time = total_time / num_iter;
     std::cout << "Average execution time (microseconds): " << avg_time << std::endl;
+    perf.report(std::cout, num_iter * num_ops);
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// hardware counters read around a timed region through perf_event_open.
+// counters are inherited by threads spawned inside the region and folded back in
+// when they are joined. anything the kernel or CPU refuses (containers, VMs,
+// perf_event_paranoid) is reported as n/a instead of failing the run
+class PerfCounters {
+public:
+    PerfCounters() {
+        add("Cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        add("Instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        add("L1D misses", PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_L1D));
+        add("LLC misses", PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_LL));
+        add("dTLB misses", PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_DTLB));
+        add("Branch misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    }
+
+    ~PerfCounters() {
+        for (auto& c : counters) {
+            if (c.fd >= 0) close(c.fd);
+        }
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // start/stop pairs accumulate, so one object can span every timed iteration
+    void start() {
+        for (auto& c : counters) {
+            if (c.fd < 0) continue;
+            ioctl(c.fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(c.fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    void stop() {
+        for (auto& c : counters) {
+            if (c.fd >= 0) ioctl(c.fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+        for (auto& c : counters) {
+            if (c.fd < 0) continue;
+            uint64_t v[3]; // value, time enabled, time running
+            if (read(c.fd, v, sizeof(v)) != static_cast<ssize_t>(sizeof(v)) || v[2] == 0) continue;
+            // scale up when the kernel had to multiplex more events than the PMU has counters
+            c.total += static_cast<double>(v[0]) * v[1] / v[2];
+        }
+    }
+
+    // one "<name> per op: <value>" line per counter, n/a when unavailable
+    void report(std::ostream& out, size_t ops) const {
+        for (const auto& c : counters) {
+            out << c.name << " per op: ";
+            if (c.fd < 0 || ops == 0) {
+                out << "n/a";
+            } else {
+                out << c.total / ops;
+            }
+            out << std::endl;
+        }
+    }
+
+private:
+    struct Counter {
+        const char* name;
+        int fd;
+        double total;
+    };
+    std::vector<Counter> counters;
+
+    static uint64_t cache(uint64_t which) {
+        return which | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+
+    void add(const char* name, uint32_t type, uint64_t config) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        const int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        counters.push_back(Counter{name, fd, 0.0});
+    }
+};
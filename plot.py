@@ -15,12 +15,16 @@ with open("results.csv", "r") as csvfile:
         data[prog]["threads"].append(threads)
         data[prog]["times"].append(avg_time)
 
+# Reference engines are drawn dashed, so each cuckoo variant reads against them.
+def line_style(prog):
+    return "--" if prog.startswith("./baseline_sets") else "-"
+
 plt.figure()
 for prog, d in data.items():
     # Sort the data by thread count.
     sorted_data = sorted(zip(d["threads"], d["times"]), key=lambda x: x[0])
     threads_sorted, times_sorted = zip(*sorted_data)
-    plt.plot(threads_sorted, times_sorted, marker="o", linestyle="-", label=prog)
+    plt.plot(threads_sorted, times_sorted, marker="o", linestyle=line_style(prog), label=prog)
 
 plt.xscale("log")
 plt.xlabel("Threads (log scale)")
@@ -29,4 +33,33 @@ plt.title("Benchmark: Average Execution Time vs Threads")
 plt.legend()
 plt.grid(True)
 plt.savefig("results_plot.png")
+
+# Misses per operation vs threads, one panel per counter; counters that were
+# unavailable on the benchmark machine are left out.
+miss_counters = ["L1D misses", "LLC misses", "dTLB misses", "Branch misses"]
+misses = {name: {} for name in miss_counters}
+with open("results.csv", "r") as csvfile:
+    reader = csv.DictReader(csvfile)
+    for row in reader:
+        for name in miss_counters:
+            value = row.get(name + " per op", "")
+            if value:
+                misses[name].setdefault(row["Program"], []).append((float(row["Threads"]), float(value)))
+
+available = [name for name in miss_counters if misses[name]]
+if available:
+    fig, axes = plt.subplots(1, len(available), figsize=(5 * len(available), 4), squeeze=False)
+    for ax, name in zip(axes[0], available):
+        for prog, points in misses[name].items():
+            threads_sorted, values_sorted = zip(*sorted(points))
+            ax.plot(threads_sorted, values_sorted, marker="o", linestyle=line_style(prog), label=prog)
+        ax.set_xscale("log")
+        ax.set_xlabel("Threads (log scale)")
+        ax.set_ylabel(name + " per op")
+        ax.set_title(name + " per op vs Threads")
+        ax.grid(True)
+    axes[0][0].legend()
+    fig.tight_layout()
+    fig.savefig("results_counters.png")
+
 plt.show()
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// zipf-distributed keys over [0, n): rank r is drawn with probability proportional to
+// 1 / (r + 1)^skew. ranks are shuffled onto keys so hot keys do not cluster in the
+// hash space. sampling is a binary search over a precomputed CDF
+class ZipfGenerator {
+public:
+    ZipfGenerator(size_t n, double skew, unsigned seed = 1) : cdf(n), keys(n) {
+        double sum = 0.0;
+        for (size_t r = 0; r < n; r++) {
+            sum += 1.0 / std::pow(static_cast<double>(r + 1), skew);
+            cdf[r] = sum;
+        }
+        for (auto& c : cdf) c /= sum;
+        std::iota(keys.begin(), keys.end(), 0);
+        std::shuffle(keys.begin(), keys.end(), std::mt19937(seed));
+    }
+
+    template<typename Gen>
+    int operator()(Gen& gen) {
+        const double u = std::uniform_real_distribution<>(0.0, 1.0)(gen);
+        const size_t r = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+        return keys[std::min(r, keys.size() - 1)];
+    }
+
+private:
+    std::vector<double> cdf;
+    std::vector<int> keys;
+};